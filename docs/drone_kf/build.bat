@@ -1,12 +1,12 @@
 @echo off
-rem Build script for WebAssembly
+rem Build script for WebAssembly, same settings as the makefile
 call "D:\Programs\Emscripten\emsdk\emsdk_env.bat" >nul 2>&1
 
-emcc sim\*.c ^
+emcc sim\*.c -O2 -msimd128 ^
   -s WASM=1 ^
-  -s MODULARIZE=1 -s EXPORT_ES6=1 -s ENVIRONMENT=web ^
-  -s EXPORTED_FUNCTIONS="["_sim_init","_sim_step","_drone_get_x","_drone_get_y","_drone_get_angle"]" ^
-  -s EXPORTED_RUNTIME_METHODS="["cwrap"]" ^
-  -o docs\sim.js
+  -s MODULARIZE=1 -s EXPORT_ES6=1 -s ENVIRONMENT=web,worker ^
+  -s EXPORTED_FUNCTIONS="["_sim_init","_sim_step","_drone_get_x","_drone_get_y","_drone_get_angle","_drone_get_x_estimate","_drone_get_y_estimate","_drone_get_angle_estimate","_drone_get_gnss_x","_drone_get_gnss_y","_telemetry_drain","_telemetry_buffer","_telemetry_record_floats","_telemetry_dropped","_sim_create","_sim_destroy","_sim_instance_step","_sim_instance_get_x","_sim_instance_get_y","_sim_instance_get_angle","_sim_instance_get_x_estimate","_sim_instance_get_y_estimate","_sim_instance_get_angle_estimate","_sim_instance_get_gnss_x","_sim_instance_get_gnss_y","_sim_instance_telemetry_drain","_sim_instance_telemetry_buffer","_sim_instance_telemetry_dropped","_sim_instance_step_n","_sim_step_n","_sim_step_targets","_sim_step_outputs","_sim_step_capacity","_sim_step_output_floats","_sim_state_ptr","_sim_instance_state"]" ^
+  -s EXPORTED_RUNTIME_METHODS="["cwrap","HEAPF32"]" ^
+  -o drone_kf_page\sim.js
 
-echo Build complete: docs\sim.jsb
\ No newline at end of file
+echo Build complete: drone_kf_page\sim.js
\ No newline at end of file
@@ -1,5 +1,7 @@
 // site/main.js (ES module)
 import createModule from './sim.js';
+import { bindSim, S, SIM_STATE_FLOATS } from './simBindings.js';
+import { createRing, ringPush, ringLatest, ringDropped } from './ring.js';
 
 const canvas = document.getElementById('c');
 const ctx = canvas.getContext('2d');
@@ -19,28 +21,112 @@ function setupCanvasSize() {
 setupCanvasSize();
 window.addEventListener('resize', setupCanvasSize);
 
-// ——— Load WASM ———
-const Module = await createModule();
-
-// Bind C exports
-const sim_init      = Module.cwrap('sim_init', 'number', ['number']);
-const sim_step      = Module.cwrap('sim_step', null, ['number', 'number']);
-const drone_get_x   = Module.cwrap('drone_get_x', 'number', []);
-const drone_get_y   = Module.cwrap('drone_get_y', 'number', []);
-const drone_get_ang = Module.cwrap('drone_get_angle', 'number', []);
-
-// NEW: estimation getters (ghost drone)
-const drone_get_x_est   = Module.cwrap('drone_get_x_estimate', 'number', []);
-const drone_get_y_est   = Module.cwrap('drone_get_y_estimate', 'number', []);
-const drone_get_ang_est = Module.cwrap('drone_get_angle_estimate', 'number', []);
+// ——— Sim: worker or main thread ———
+// With cross origin isolation (COOP/COEP headers) SharedArrayBuffer is
+// available and the sim runs in simWorker.js at its own fixed rate: the page
+// reads the newest state snapshot from one ring and sends targets through
+// another, so rendering and physics never wait on each other. Without it, or
+// if the worker fails to start, the sim steps on this thread inside
+// requestAnimationFrame as before.
+const DT = 0.01; // s
+const USE_WORKER = typeof SharedArrayBuffer !== 'undefined' && self.crossOriginIsolated;
+const STATE_RING_CAPACITY = 8;  // snapshots, the page only ever reads the newest
+const INPUT_RING_CAPACITY = 16; // targets, one pushed per frame
+
+let simState;  // Float32Array in the SIM_STATE_T layout, see simBindings.js
+let simAdvance; // simAdvance(frameDt, tx, ty), moves the sim along for this frame
+
+// Resolves once the worker reports ready, rejects if it reports an error,
+// fails to load its module or cannot deserialize a message
+async function startWorkerSim() {
+  const stateRing = createRing(STATE_RING_CAPACITY, SIM_STATE_FLOATS);
+  const inputRing = createRing(INPUT_RING_CAPACITY, 2);
+  const target = new Float32Array([0, 0.5]);
+  const state = new Float32Array(SIM_STATE_FLOATS);
+
+  const worker = new Worker(new URL('./simWorker.js', import.meta.url), { type: 'module' });
+  try {
+    await new Promise((resolve, reject) => {
+      worker.onmessage = (e) => {
+        if (e.data.type === 'ready') resolve();
+        else reject(new Error(e.data.message));
+      };
+      worker.onerror = (e) => { e.preventDefault(); reject(new Error(e.message || 'worker failed to load')); };
+      worker.onmessageerror = () => reject(new Error('worker message could not be read'));
+      worker.postMessage({
+        dt: DT, target: Array.from(target),
+        stateRing: stateRing.sab, stateCapacity: STATE_RING_CAPACITY,
+        inputRing: inputRing.sab, inputCapacity: INPUT_RING_CAPACITY
+      });
+    });
+  } catch (err) {
+    worker.terminate();
+    throw err;
+  }
+  worker.onmessage = null;
+  worker.onerror = (e) => console.error('sim worker:', e.message);
+
+  simState = state;
+  simAdvance = (frameDt, tx, ty) => {
+    target[0] = tx;
+    target[1] = ty;
+    ringPush(inputRing, target);      // a full ring drops it, the next frame resends
+    ringLatest(stateRing, simState);  // keeps the previous snapshot if none is new
+  };
+  window.simDropped = () => ({ states: ringDropped(stateRing), inputs: ringDropped(inputRing) });
+}
 
-// NEW: GNSS getters
-const drone_get_gnss_x = Module.cwrap('drone_get_gnss_x', 'number', []);
-const drone_get_gnss_y = Module.cwrap('drone_get_gnss_y', 'number', []);
+async function startMainSim() {
+  const Module = await createModule();
+  const sim = bindSim(Module, DT);
+  simState = sim.state;
+
+  // Filter telemetry: one record per GNSS update, kept in a ring inside the WASM heap
+  const telemetry_drain         = Module.cwrap('telemetry_drain', 'number', []);
+  const telemetry_buffer        = Module.cwrap('telemetry_buffer', 'number', []);
+  const telemetry_record_floats = Module.cwrap('telemetry_record_floats', 'number', []);
+  const TELEMETRY_FLOATS = telemetry_record_floats();
+
+  // Returns the pending records as one Float32Array, TELEMETRY_FLOATS per record:
+  // seq, x[5], Pdiag[5], y[4], gainNorm
+  function drainTelemetry() {
+    const count = telemetry_drain();
+    const ptr = telemetry_buffer();
+    if (count === 0 || ptr === 0) return new Float32Array(0);
+    return Module.HEAPF32.slice(ptr >> 2, (ptr >> 2) + count * TELEMETRY_FLOATS);
+  }
+  window.drainTelemetry = drainTelemetry; // pull from the dev console when needed
+
+  // Fixed steps from the frame time, a long frame is clamped
+  let acc = 0;
+  simAdvance = (frameDt, tx, ty) => {
+    if (frameDt > 0.25) frameDt = 0.25;
+    acc += frameDt;
+
+    let steps = 0;
+    while (acc >= DT) {
+      steps++;
+      acc -= DT;
+    }
+
+    // all of this frame's steps in one call
+    sim.step(steps, tx, ty);
+  };
+}
 
-// --- Sim/controls setup ---
-const DT = 0.01; // s
-if (sim_init(DT) !== 0) throw new Error('sim_init failed');
+let workerStarted = false;
+if (USE_WORKER) {
+  try {
+    await startWorkerSim();
+    workerStarted = true;
+  } catch (err) {
+    console.warn('sim worker did not start, running the sim on the main thread:', err.message);
+  }
+}
+if (!workerStarted) {
+  await startMainSim();
+}
+window.simState = simState; // inspect from the dev console
 
 let keys = { up:false, down:false, left:false, right:false };
 window.addEventListener('keydown', (e) => {
@@ -291,41 +377,35 @@ function drawFrame(drone, ghostDrone, target, gnss) {
   renderWorld(insetCam, insetViewport, drone, target, ghostDrone, gnss);
 }
 
-// ——— Fixed-step sim loop ———
+// ——— Frame loop ———
 let last = performance.now();
-let acc = 0;
 
 function tick(now) {
-  let dt = (now - last) / 1000;
+  const dt = (now - last) / 1000;
   last = now;
-  if (dt > 0.25) dt = 0.25;
-  acc += dt;
 
   const Y_pos = (keys.up ? +Y_STEP : 0) + (keys.down ? -Y_STEP : 0);
   const X_pos = (keys.right ? X_STEP : 0) + (keys.left ? -X_STEP : 0);
 
-  while (acc >= DT) {
-    sim_step(0.7 * X_pos, 0.4 * Y_pos + 0.5);
-    acc -= DT;
-  }
+  simAdvance(dt, 0.7 * X_pos, 0.4 * Y_pos + 0.5);
 
   const drone = {
-    x:   drone_get_x(),
-    y:   drone_get_y(),
-    ang: drone_get_ang()
+    x:   simState[S.X],
+    y:   simState[S.Y],
+    ang: simState[S.ANG]
   };
 
   // NEW: ghost/estimated state
   const ghostDrone = {
-    x:   drone_get_x_est(),
-    y:   drone_get_y_est(),
-    ang: drone_get_ang_est()
+    x:   simState[S.X_EST],
+    y:   simState[S.Y_EST],
+    ang: simState[S.ANG_EST]
   };
 
   // NEW: GNSS reading
   const gnss = {
-    x: drone_get_gnss_x(),
-    y: drone_get_gnss_y()
+    x: simState[S.GNSS_X],
+    y: simState[S.GNSS_Y]
   };
 
   // Use the exact same mapping the sim sees so the '+' matches the control input
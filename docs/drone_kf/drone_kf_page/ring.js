@@ -0,0 +1,55 @@
+// ring.js (ES module)
+// Lock-free single producer / single consumer ring of fixed size float records
+// in a SharedArrayBuffer. head is only written by the producer, tail only by the
+// consumer, both are free running uint32 counters (capacity is a power of two so
+// they wrap cleanly). The record is written before head is published with
+// Atomics.store, so the consumer never sees a half written record.
+
+const HEAD = 0;
+const TAIL = 1;
+const DROPPED = 2;      // records the producer could not push, ring full
+const HEADER_BYTES = 16;
+
+export function createRing(capacity, recordFloats) {
+  if (capacity & (capacity - 1)) throw new Error('ring capacity must be a power of two');
+  const sab = new SharedArrayBuffer(HEADER_BYTES + capacity * recordFloats * 4);
+  return openRing(sab, capacity, recordFloats);
+}
+
+// The other side of a ring, from the buffer posted to it
+export function openRing(sab, capacity, recordFloats) {
+  return {
+    sab, capacity, recordFloats,
+    ctrl: new Uint32Array(sab, 0, HEADER_BYTES / 4),
+    data: new Float32Array(sab, HEADER_BYTES, capacity * recordFloats)
+  };
+}
+
+// Producer. Copies values (recordFloats long) in, false if the ring is full
+export function ringPush(ring, values) {
+  const head = Atomics.load(ring.ctrl, HEAD);
+  const tail = Atomics.load(ring.ctrl, TAIL);
+  if (((head - tail) >>> 0) >= ring.capacity) {
+    Atomics.add(ring.ctrl, DROPPED, 1);
+    return false;
+  }
+  ring.data.set(values, (head % ring.capacity) * ring.recordFloats);
+  Atomics.store(ring.ctrl, HEAD, (head + 1) >>> 0);
+  return true;
+}
+
+// Consumer. Copies the newest record into out and skips the older ones,
+// false if there was nothing new
+export function ringLatest(ring, out) {
+  const head = Atomics.load(ring.ctrl, HEAD);
+  const tail = Atomics.load(ring.ctrl, TAIL);
+  if (head === tail) return false;
+  const slot = (((head - 1) >>> 0) % ring.capacity) * ring.recordFloats;
+  out.set(ring.data.subarray(slot, slot + ring.recordFloats));
+  Atomics.store(ring.ctrl, TAIL, head);
+  return true;
+}
+
+export function ringDropped(ring) {
+  return Atomics.load(ring.ctrl, DROPPED);
+}
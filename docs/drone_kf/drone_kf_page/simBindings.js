@@ -0,0 +1,52 @@
+// simBindings.js (ES module)
+// C exports used by both the page and the worker, and the state block layout.
+
+// Shared state block (sim/simState.h), rewritten by the sim after every step
+export const SIM_STATE_VERSION = 1;
+export const S = {
+  VERSION: 0, FLOATS: 1, STEP: 2, TIME: 3,
+  X: 4, Y: 5, ANG: 6, VX: 7, VY: 8, ANG_VEL: 9,
+  X_EST: 10, Y_EST: 11, ANG_EST: 12, VX_EST: 13, VY_EST: 14,
+  GNSS_X: 15, GNSS_Y: 16, GNSS_VX: 17, GNSS_VY: 18,
+  P_DIAG: 19, // 5 floats: x, y, vx, vy, g
+  LEFT: 24, RIGHT: 25, TARGET_X: 26, TARGET_Y: 27
+};
+export const SIM_STATE_FLOATS = 28;
+
+// Initialises the default instance and returns
+//   state: Float32Array view on the state block. Made once: the block never
+//          moves and the heap does not grow.
+//   step(n, tx, ty): runs n steps toward (tx, ty) in as few calls as possible
+export function bindSim(Module, dt) {
+  const sim_init      = Module.cwrap('sim_init', 'number', ['number']);
+  const sim_step_n    = Module.cwrap('sim_step_n', 'number', ['number', 'number', 'number']);
+  const sim_state_ptr = Module.cwrap('sim_state_ptr', 'number', []);
+
+  // Bulk stepping: targets go into linear memory and one sim_step_n call
+  // advances up to STEP_CAPACITY steps
+  const STEP_TARGETS_PTR = Module.cwrap('sim_step_targets', 'number', [])();
+  const STEP_CAPACITY    = Module.cwrap('sim_step_capacity', 'number', [])();
+
+  if (sim_init(dt) !== 0) throw new Error('sim_init failed');
+
+  const ptr = sim_state_ptr();
+  const state = new Float32Array(Module.HEAPF32.buffer, ptr, Module.HEAPF32[(ptr >> 2) + S.FLOATS]);
+  if (state[S.VERSION] !== SIM_STATE_VERSION) {
+    throw new Error('sim state layout ' + state[S.VERSION] + ', page expects ' + SIM_STATE_VERSION);
+  }
+
+  function step(n, tx, ty) {
+    while (n > 0) {
+      const count = Math.min(n, STEP_CAPACITY);
+      const targets = Module.HEAPF32.subarray(STEP_TARGETS_PTR >> 2, (STEP_TARGETS_PTR >> 2) + 2 * count);
+      for (let i = 0; i < count; i++) {
+        targets[2 * i] = tx;
+        targets[2 * i + 1] = ty;
+      }
+      sim_step_n(count, STEP_TARGETS_PTR, 0);
+      n -= count;
+    }
+  }
+
+  return { state, step };
+}
@@ -0,0 +1,53 @@
+// simWorker.js (ES module worker)
+// Runs the sim at a fixed rate off the main thread. Snapshots of the state block
+// go out through one ring, targets from the page come in through another.
+import createModule from './sim.js';
+import { bindSim, SIM_STATE_FLOATS } from './simBindings.js';
+import { openRing, ringPush, ringLatest } from './ring.js';
+
+const MAX_CATCH_UP = 1.0; // s, a longer stall (e.g. suspended tab) is skipped, not replayed
+
+self.onmessage = async (e) => {
+  const { dt, target, stateRing, stateCapacity, inputRing, inputCapacity } = e.data;
+
+  // a failed start is reported so the page can fall back to the main thread
+  let sim;
+  try {
+    const Module = await createModule();
+    sim = bindSim(Module, dt);
+  } catch (err) {
+    self.postMessage({ type: 'error', message: String(err && err.message || err) });
+    return;
+  }
+  const states = openRing(stateRing, stateCapacity, SIM_STATE_FLOATS);
+  const inputs = openRing(inputRing, inputCapacity, 2);
+
+  const input = new Float32Array(target);
+  const maxSteps = Math.round(MAX_CATCH_UP / dt);
+  let start = performance.now();
+  let done = 0;
+
+  ringPush(states, sim.state);
+
+  function run() {
+    ringLatest(inputs, input);
+
+    let due = Math.floor((performance.now() - start) / 1000 / dt) - done;
+    if (due > maxSteps) {
+      console.warn('sim worker fell ' + (due * dt).toFixed(2) + ' s behind, skipping ahead');
+      start += (due - maxSteps) * dt * 1000;
+      due = maxSteps;
+    }
+
+    if (due > 0) {
+      sim.step(due, input[0], input[1]);
+      done += due;
+      ringPush(states, sim.state);
+    }
+
+    setTimeout(run, dt * 1000 / 2);
+  }
+  run();
+
+  self.postMessage({ type: 'ready' });
+};
@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "linalg.h"
+#include "linalgFixed.h"
+#include "linalgSimd.h"
+
+// SIMD against scalar kernels. the same random products, sums and scalings
+// run in a LINALG_NO_SIMD build, which writes the bits of every result with
+// -dump, and in the SIMD build, which reads them back with -compare and fails
+// if any result is more than LINALG_SIMD_ULP apart. see make check.
+
+#define CHECK_CASES 2000
+
+typedef struct{
+    FILE* file;
+    int compare; // 0 dump, 1 compare
+    int count;
+    uint32_t ulpMax;
+    int failed;
+} CHECK_T;
+
+static uint32_t checkRandom(uint32_t* state)
+{
+    // xorshift32
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// entries in [-4, 4) with a spread of magnitudes, so the sums round
+static void checkFill(float* X, int n, uint32_t* state)
+{
+    for(int iter = 0; iter < n; iter++)
+    {
+        float unit = (float)(checkRandom(state) >> 8) / 16777216.0f;
+        float scale = (float)(1 << (checkRandom(state) % 8)) / 32.0f;
+        X[iter] = (unit * 8 - 4) * scale;
+    }
+}
+
+static void checkMatrix(MATRIX_T* X, int rows, int cols, uint32_t* state)
+{
+    X->rows = rows;
+    X->cols = cols;
+    checkFill(X->arr, rows * cols, state);
+}
+
+// monotonic integer order of the floats, the difference is the ulp distance
+static int64_t checkOrdered(float x)
+{
+    int32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits < 0 ? (int64_t)INT32_MIN - bits : bits;
+}
+
+static void checkResult(CHECK_T* check, const char* name, const float* X, int n)
+{
+    for(int iter = 0; iter < n; iter++)
+    {
+        uint32_t bits;
+        memcpy(&bits, &X[iter], sizeof(bits));
+        check->count++;
+
+        if(!check->compare)
+        {
+            fprintf(check->file, "%08x\n", (unsigned int)bits);
+            continue;
+        }
+
+        unsigned int expected;
+        if(fscanf(check->file, "%x", &expected) != 1)
+        {
+            fprintf(stderr, "%s: reference ends at result %d\n", name, check->count);
+            check->failed = 1;
+            return;
+        }
+
+        float reference;
+        uint32_t referenceBits = expected;
+        memcpy(&reference, &referenceBits, sizeof(reference));
+        int64_t distance = checkOrdered(X[iter]) - checkOrdered(reference);
+        uint32_t ulp = (uint32_t)(distance < 0 ? -distance : distance);
+
+        if(ulp > check->ulpMax){check->ulpMax = ulp;}
+        if(ulp > LINALG_SIMD_ULP && !check->failed)
+        {
+            fprintf(stderr, "%s: result %d is %.9g, scalar %.9g, %u ulp apart\n", name, check->count, X[iter], reference, (unsigned int)ulp);
+            check->failed = 1;
+        }
+    }
+}
+
+static void checkCase(CHECK_T* check, uint32_t* state)
+{
+    int rows  = 1 + checkRandom(state) % 5;
+    int inner = 1 + checkRandom(state) % 5;
+    int cols  = 1 + checkRandom(state) % 5;
+    MATRIX_T A, B, C, X;
+
+    // linalg.c, the products go through matdMulKernel
+    checkMatrix(&A, rows, inner, state);
+    checkMatrix(&B, inner, cols, state);
+    checkMatrix(&C, rows, cols, state);
+
+    matMulInto(&X, &A, &B);
+    checkResult(check, "matMulInto", X.arr, rows * cols);
+    X = C;
+    matMulAddInto(&X, &A, &B);
+    checkResult(check, "matMulAddInto", X.arr, rows * cols);
+
+    MATRIX_T BT;
+    matTransposeInto(&BT, &B);
+    matMulTransBInto(&X, &A, &BT);
+    checkResult(check, "matMulTransBInto", X.arr, rows * cols);
+
+    MATRIX_T AT;
+    matTransposeInto(&AT, &A);
+    matMulTransAInto(&X, &AT, &B);
+    checkResult(check, "matMulTransAInto", X.arr, rows * cols);
+
+    MATRIX_T D;
+    checkMatrix(&D, rows, cols, state);
+    matAddInto(&X, &C, &D);
+    checkResult(check, "matAddInto", X.arr, rows * cols);
+    matSubInto(&X, &C, &D);
+    checkResult(check, "matSubInto", X.arr, rows * cols);
+    matTimesScalarInto(&X, &C, A.arr[0]);
+    checkResult(check, "matTimesScalarInto", X.arr, rows * cols);
+
+    // linalgFixed.h, the kernels behind the generated filter types
+    float Y[LINALG_FIXED_MAX * LINALG_FIXED_MAX];
+    fixedMul(Y, A.arr, B.arr, rows, inner, cols, 0, 0);
+    checkResult(check, "fixedMul", Y, rows * cols);
+    memcpy(Y, C.arr, sizeof(float) * rows * cols);
+    fixedMul(Y, A.arr, BT.arr, rows, inner, cols, 1, 1);
+    checkResult(check, "fixedMul transB", Y, rows * cols);
+    fixedAdd(Y, C.arr, D.arr, rows * cols);
+    checkResult(check, "fixedAdd", Y, rows * cols);
+    fixedSub(Y, C.arr, D.arr, rows * cols);
+    checkResult(check, "fixedSub", Y, rows * cols);
+
+    // packed symmetric P, inner x inner
+    float P[LINALG_FIXED_MAX * (LINALG_FIXED_MAX + 1) / 2];
+    checkFill(P, inner * (inner + 1) / 2, state);
+    fixedSymTriple(Y, A.arr, P, rows, inner, 0);
+    checkResult(check, "fixedSymTriple", Y, rows * (rows + 1) / 2);
+    fixedSymMulT(Y, P, A.arr, inner, rows);
+    checkResult(check, "fixedSymMulT", Y, inner * rows);
+}
+
+int main(int argc, char** argv)
+{
+    CHECK_T check = {NULL, 0, 0, 0, 0};
+
+    if(argc == 3 && !strcmp(argv[1], "-dump"))
+    {
+        check.file = strcmp(argv[2], "-") ? fopen(argv[2], "w") : stdout;
+    }
+    else if(argc == 3 && !strcmp(argv[1], "-compare"))
+    {
+        check.compare = 1;
+        check.file = fopen(argv[2], "r");
+    }
+    else
+    {
+        fprintf(stderr, "usage: %s -dump file | -compare file\n", argv[0]);
+        return 1;
+    }
+    if(check.file == NULL)
+    {
+        fprintf(stderr, "cannot open %s\n", argv[2]);
+        return 1;
+    }
+
+    uint32_t state = 0x9E3779B9u;
+    for(int iter = 0; iter < CHECK_CASES && !check.failed; iter++)
+    {
+        checkCase(&check, &state);
+    }
+
+    if(check.compare)
+    {
+        fprintf(stderr, "linalg, %s against scalar: %d results, max %u ulp, bound %d\n",
+            LINALG_SIMD ? "simd" : "scalar", check.count, (unsigned int)check.ulpMax, LINALG_SIMD_ULP);
+    }
+    if(check.file != stdout)
+    {
+        fclose(check.file);
+    }
+    return check.failed;
+}
@@ -0,0 +1,411 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "box.h"
+#include "droneBench.h"
+#include "fastMath.h"
+
+// headless runner for the simulation, see usage() below.
+//
+// target script: one "t x y" per line, the target (m) holds from time t (s)
+// until the next line. lines starting with # are comments. without a script
+// the target stays at the origin.
+//
+// -compare takes a trajectory written by an earlier run (-o) and checks the
+// steps it holds against this run, e.g. a SIM_LIBM_MATH build against the
+// fast math one (make check).
+
+typedef struct{
+    float t;
+    float x;
+    float y;
+} TARGET_T;
+
+typedef struct{
+    TARGET_T* items;
+    int count;
+} TARGET_SCRIPT_T;
+
+// truth and estimate of one written step, the columns compared by -compare
+#define TRAJECTORY_VALUES 6
+
+typedef struct{
+    int step;
+    float values[TRAJECTORY_VALUES]; // x y angle x_est y_est angle_est
+} TRAJECTORY_ROW_T;
+
+typedef struct{
+    TRAJECTORY_ROW_T* rows;
+    int count;
+} TRAJECTORY_T;
+
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  -n steps      sim steps to run (default 3000)\n"
+        "  -dt seconds   step size (default 0.01)\n"
+        "  -t file       target script, lines of \"t x y\"\n"
+        "  -o file       trajectory output (default stdout, - for stdout)\n"
+        "  -every k      write every k-th step (default 1)\n"
+        "  -seed s       sensor noise seed (default 0)\n"
+        "  -instances k  run k independent drones, ids 0..k-1 (default 1),\n"
+        "                the trajectory is the one of id 0\n"
+        "  -q            no trajectory, only the timing summary\n"
+        "  -compare file check the steps in a trajectory file from -o against this run\n"
+        "  -tol value    largest difference -compare accepts (default 1e-4)\n"
+        "  -bench        run the benchmarks in droneBench.h instead of the sim\n",
+        name);
+}
+
+// 0 on success, 1 on failure
+static int loadTargets(const char* path, TARGET_SCRIPT_T* script)
+{
+    FILE* file = fopen(path, "r");
+    if(file == NULL)
+    {
+        fprintf(stderr, "cannot open target script %s\n", path);
+        return 1;
+    }
+
+    int capacity = 64;
+    script->items = malloc(sizeof(TARGET_T) * capacity);
+    script->count = 0;
+
+    char line[256];
+    int lineNumber = 0;
+    while(fgets(line, sizeof(line), file))
+    {
+        lineNumber++;
+
+        char* start = line;
+        while(*start == ' ' || *start == '\t'){start++;}
+        if(*start == '#' || *start == '\n' || *start == '\r' || *start == 0)
+        {
+            continue;
+        }
+
+        TARGET_T target;
+        if(sscanf(start, "%f %f %f", &(target.t), &(target.x), &(target.y)) != 3)
+        {
+            fprintf(stderr, "%s:%d: expected \"t x y\"\n", path, lineNumber);
+            fclose(file);
+            return 1;
+        }
+        if(script->count && target.t < script->items[script->count - 1].t)
+        {
+            fprintf(stderr, "%s:%d: times must not decrease\n", path, lineNumber);
+            fclose(file);
+            return 1;
+        }
+
+        if(script->count == capacity)
+        {
+            capacity *= 2;
+            script->items = realloc(script->items, sizeof(TARGET_T) * capacity);
+        }
+        script->items[script->count++] = target;
+    }
+
+    fclose(file);
+    return 0;
+}
+
+// batch dimensions of the throughput bench
+#define BENCH_BATCH_DRONES 4096
+#define BENCH_BATCH_STEPS  1000
+#define BENCH_BATCH_FIELDS 15 // float arrays in DRONE_BATCH_T
+
+// integrator accuracy and cost at every dt that divides the input hold of the
+// bench script, batch against scalar dynamics on the model of sim, and the
+// error of fastMath.h. returns 1 if the batch path does not match the scalar
+// one bit for bit or the math error exceeds the documented bound
+static int runBench(SIM_T* sim)
+{
+    static const char* schemes[DRONE_BENCH_SCHEMES] = {"const-accel", "semi-impl", "verlet", "rk4"};
+    static const float steps[] = {0.01f, 0.02f, 0.04f};
+    DRONE_T* model = sim_instance_drone(sim);
+    DRONE_BENCH_RESULT_T results[DRONE_BENCH_SCHEMES];
+
+    printf("integrators, 20 s open loop against rk4 in double\n");
+    printf("%-6s %-12s %12s %12s %10s\n", "dt", "scheme", "pos err m", "angle err", "ns/step");
+    for(int iter = 0; iter < (int)(sizeof(steps) / sizeof(steps[0])); iter++)
+    {
+        int count = droneIntegratorBench(model, steps[iter], 20, 5, results);
+        for(int scheme = 0; scheme < count; scheme++)
+        {
+            printf("%-6.2f %-12s %12.3e %12.3e %10.1f\n", results[scheme].dt, schemes[results[scheme].scheme],
+                results[scheme].posErrorMax, results[scheme].angleErrorMax, results[scheme].nsPerStep);
+        }
+    }
+
+    size_t bytes = BENCH_BATCH_FIELDS * (sizeof(float) * BENCH_BATCH_DRONES + ARENA_ALIGN);
+    void* buffer = malloc(bytes);
+    ARENA_T arena;
+    DRONE_BATCH_BENCH_T batch;
+
+    if(buffer)
+    {
+        arenaInit(&arena, buffer, bytes);
+    }
+    if(buffer == NULL || droneBatchBench(model, &arena, BENCH_BATCH_DRONES, BENCH_BATCH_STEPS, &batch))
+    {
+        fprintf(stderr, "out of memory for the batch bench\n");
+        free(buffer);
+        return 1;
+    }
+    free(buffer);
+
+    printf("\nbatch dynamics, %d drones x %d steps, dt %.3f\n", batch.drones, batch.steps, model->dt);
+    printf("batch  %.3e drone-steps/s\n", batch.batchRate);
+    printf("scalar %.3e drone-steps/s\n", batch.scalarRate);
+    printf("max deviation batch vs scalar %.3e\n", batch.maxDeviation);
+    if(batch.maxDeviation != 0)
+    {
+        fprintf(stderr, "batch path does not match the scalar path\n");
+        return 1;
+    }
+
+    DRONE_MATH_BENCH_T math;
+    droneMathAccuracy(1e4f, 1000000, &math);
+
+    printf("\nfast math against double libm\n");
+    printf("sincos %.3e abs, |x| < 1e4, bound %.1e\n", math.sinCosErrorMax, FAST_MATH_SINCOS_ERROR);
+    printf("atan2  %.3e rad, bound %.1e\n", math.atan2ErrorMax, FAST_MATH_ATAN2_ERROR);
+    if(math.sinCosErrorMax > FAST_MATH_SINCOS_ERROR || math.atan2ErrorMax > FAST_MATH_ATAN2_ERROR)
+    {
+        fprintf(stderr, "fast math error above its documented bound\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+// reads a trajectory written with -o. 0 on success, 1 on failure
+static int loadTrajectory(const char* path, TRAJECTORY_T* trajectory)
+{
+    FILE* file = fopen(path, "r");
+    if(file == NULL)
+    {
+        fprintf(stderr, "cannot open trajectory %s\n", path);
+        return 1;
+    }
+
+    int capacity = 1024;
+    trajectory->rows = malloc(sizeof(TRAJECTORY_ROW_T) * capacity);
+    trajectory->count = 0;
+
+    char line[512];
+    int lineNumber = 0;
+    while(fgets(line, sizeof(line), file))
+    {
+        lineNumber++;
+        if(line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+        {
+            continue;
+        }
+
+        TRAJECTORY_ROW_T row;
+        float t;
+        float* v = row.values;
+        if(sscanf(line, "%d %f %f %f %f %f %f %f", &(row.step), &t, &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) != 8)
+        {
+            fprintf(stderr, "%s:%d: not a trajectory line\n", path, lineNumber);
+            fclose(file);
+            return 1;
+        }
+
+        if(trajectory->count == capacity)
+        {
+            capacity *= 2;
+            trajectory->rows = realloc(trajectory->rows, sizeof(TRAJECTORY_ROW_T) * capacity);
+        }
+        trajectory->rows[trajectory->count++] = row;
+    }
+
+    fclose(file);
+    return 0;
+}
+
+// raises worst to the largest difference of instance 0 against the reference
+// row of step. returns 1 if the reference has that step, 0 otherwise
+static int compareStep(SIM_T* sim, int step, TRAJECTORY_T* reference, int* next, float* worst)
+{
+    while(*next < reference->count && reference->rows[*next].step < step){(*next)++;}
+    if(*next == reference->count || reference->rows[*next].step != step)
+    {
+        return 0;
+    }
+
+    float current[TRAJECTORY_VALUES] = {
+        sim_instance_get_x(sim), sim_instance_get_y(sim), sim_instance_get_angle(sim),
+        sim_instance_get_x_estimate(sim), sim_instance_get_y_estimate(sim), sim_instance_get_angle_estimate(sim)
+    };
+
+    for(int iter = 0; iter < TRAJECTORY_VALUES; iter++)
+    {
+        float diff = fabsf(current[iter] - reference->rows[*next].values[iter]);
+        if(diff > *worst){*worst = diff;}
+    }
+    (*next)++;
+    return 1;
+}
+
+int main(int argc, char** argv)
+{
+    int steps = 3000;
+    float dt = 0.01f;
+    int every = 1;
+    int quiet = 0;
+    unsigned int seed = 0;
+    int instances = 1;
+    int bench = 0;
+    float tolerance = 1e-4f;
+    const char* comparePath = NULL;
+    const char* targetPath = NULL;
+    const char* outputPath = "-";
+
+    for(int iter = 1; iter < argc; iter++)
+    {
+        int hasValue = iter + 1 < argc;
+
+        if(!strcmp(argv[iter], "-n") && hasValue){steps = atoi(argv[++iter]);}
+        else if(!strcmp(argv[iter], "-dt") && hasValue){dt = (float)atof(argv[++iter]);}
+        else if(!strcmp(argv[iter], "-t") && hasValue){targetPath = argv[++iter];}
+        else if(!strcmp(argv[iter], "-o") && hasValue){outputPath = argv[++iter];}
+        else if(!strcmp(argv[iter], "-every") && hasValue){every = atoi(argv[++iter]);}
+        else if(!strcmp(argv[iter], "-seed") && hasValue){seed = (unsigned int)strtoul(argv[++iter], NULL, 10);}
+        else if(!strcmp(argv[iter], "-instances") && hasValue){instances = atoi(argv[++iter]);}
+        else if(!strcmp(argv[iter], "-q")){quiet = 1;}
+        else if(!strcmp(argv[iter], "-compare") && hasValue){comparePath = argv[++iter];}
+        else if(!strcmp(argv[iter], "-tol") && hasValue){tolerance = (float)atof(argv[++iter]);}
+        else if(!strcmp(argv[iter], "-bench")){bench = 1;}
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if(steps < 0 || dt <= 0 || every < 1 || instances < 1)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if(bench)
+    {
+        SIM_T* sim = sim_create(dt, seed, 0);
+        if(sim == NULL)
+        {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        int status = runBench(sim);
+        sim_destroy(sim);
+        return status;
+    }
+
+    TARGET_SCRIPT_T script = {NULL, 0};
+    if(targetPath && loadTargets(targetPath, &script))
+    {
+        return 1;
+    }
+
+    TRAJECTORY_T reference = {NULL, 0};
+    if(comparePath && loadTrajectory(comparePath, &reference))
+    {
+        return 1;
+    }
+
+    FILE* out = NULL;
+    if(!quiet)
+    {
+        out = strcmp(outputPath, "-") ? fopen(outputPath, "w") : stdout;
+        if(out == NULL)
+        {
+            fprintf(stderr, "cannot open output %s\n", outputPath);
+            return 1;
+        }
+        fprintf(out, "# step t x y angle x_est y_est angle_est gnss_x gnss_y target_x target_y\n");
+    }
+
+    SIM_T** sims = malloc(sizeof(SIM_T*) * instances);
+    for(int iter = 0; iter < instances; iter++)
+    {
+        sims[iter] = sim_create(dt, seed, (unsigned int)iter);
+        if(sims[iter] == NULL)
+        {
+            fprintf(stderr, "out of memory at instance %d\n", iter);
+            return 1;
+        }
+    }
+
+    TARGET_T target = {0, 0, 0};
+    int next = 0;
+    int nextReference = 0;
+    int compared = 0;
+    float deviation = 0;
+    clock_t start = clock();
+
+    for(int step = 0; step < steps; step++)
+    {
+        float t = step * dt;
+        while(next < script.count && script.items[next].t <= t)
+        {
+            target = script.items[next++];
+        }
+
+        for(int iter = 0; iter < instances; iter++)
+        {
+            sim_instance_step(sims[iter], target.x, target.y);
+        }
+
+        if(comparePath)
+        {
+            compared += compareStep(sims[0], step, &reference, &nextReference, &deviation);
+        }
+
+        if(out && step % every == 0)
+        {
+            SIM_T* sim = sims[0];
+            fprintf(out, "%d %.4f %.6f %.6f %.6f %.6f %.6f %.6f %.6f %.6f %.4f %.4f\n",
+                step, t + dt,
+                sim_instance_get_x(sim), sim_instance_get_y(sim), sim_instance_get_angle(sim),
+                sim_instance_get_x_estimate(sim), sim_instance_get_y_estimate(sim), sim_instance_get_angle_estimate(sim),
+                sim_instance_get_gnss_x(sim), sim_instance_get_gnss_y(sim),
+                target.x, target.y);
+        }
+    }
+
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    double total = (double)steps * instances;
+    fprintf(stderr, "%d steps x %d instances in %.3f s, %.0f steps/s\n", steps, instances, seconds, seconds > 0 ? total / seconds : 0);
+
+    int status = 0;
+    if(comparePath)
+    {
+        fprintf(stderr, "max deviation from %s %.3e, tolerance %.1e, %d steps compared\n", comparePath, deviation, tolerance, compared);
+        if(deviation > tolerance || compared == 0)
+        {
+            fprintf(stderr, "trajectory outside tolerance\n");
+            status = 1;
+        }
+    }
+
+    if(out && out != stdout)
+    {
+        fclose(out);
+    }
+    for(int iter = 0; iter < instances; iter++)
+    {
+        sim_destroy(sims[iter]);
+    }
+    free(sims);
+    free(script.items);
+    free(reference.rows);
+    return status;
+}
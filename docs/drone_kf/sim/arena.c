@@ -0,0 +1,47 @@
+#include "arena.h"
+#include <stdint.h>
+
+void arenaInit(ARENA_T* arena, void* buffer, size_t size)
+{
+    // align the start so every allocation is aligned
+    uintptr_t start = ((uintptr_t)buffer + (ARENA_ALIGN - 1)) & ~(uintptr_t)(ARENA_ALIGN - 1);
+    size_t skipped = start - (uintptr_t)buffer;
+
+    arena->base = (unsigned char*)start;
+    arena->size = (size > skipped) ? size - skipped : 0;
+    arena->used = 0;
+}
+
+// returns NULL if the arena is exhausted
+void* arenaAlloc(ARENA_T* arena, size_t bytes)
+{
+    size_t rounded = (bytes + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1);
+
+    if(rounded > arena->size - arena->used)
+    {
+        return NULL;
+    }
+
+    void* ptr = arena->base + arena->used;
+    arena->used += rounded;
+    return ptr;
+}
+
+void arenaReset(ARENA_T* arena)
+{
+    arena->used = 0;
+}
+
+// everything allocated after arenaMark is dropped by arenaRelease
+size_t arenaMark(ARENA_T* arena)
+{
+    return arena->used;
+}
+
+void arenaRelease(ARENA_T* arena, size_t mark)
+{
+    if(mark <= arena->used)
+    {
+        arena->used = mark;
+    }
+}
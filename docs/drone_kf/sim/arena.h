@@ -0,0 +1,24 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// bump allocator over a caller provided buffer
+// nothing is freed individually, the whole arena is reset at once
+// (or rolled back to a mark) so there is no malloc in the sim loop
+
+#define ARENA_ALIGN 16 // enough for the simd loads in linalgSimd.h
+
+typedef struct{
+    unsigned char* base;
+    size_t size;
+    size_t used;
+} ARENA_T;
+
+void   arenaInit(ARENA_T* , void* , size_t );
+void*  arenaAlloc(ARENA_T* , size_t );
+void   arenaReset(ARENA_T* );
+size_t arenaMark(ARENA_T* );
+void   arenaRelease(ARENA_T* , size_t );
+
+#endif
@@ -1,6 +1,8 @@
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
+#include "box.h"
 #include "drone.h"
 #include "droneDynamics.h"
 #include "droneController.h"
@@ -8,36 +10,306 @@
 #include "droneEstimation.h"
 #include "linalg.h"
 #include "kalman.h"
-#include <emscripten/emscripten.h>
+#include "telemetry.h"
+#include "arena.h"
+#include "simPlatform.h"
+
+// sensor noise seed of the default instance, runs with the same seed see the same noise
+#ifndef SIM_NOISE_SEED
+#define SIM_NOISE_SEED 0
+#endif
+
+// per step scratch memory for dynamically sized matrices, reset after every step
+#define SIM_SCRATCH_BYTES (16 * 1024)
+
+// one simulation. everything a step touches is in this block, so instances
+// share no state and can be stepped from different threads. sim_create
+// allocates it cache line aligned, the default instance is static
+struct SIM
+{
+    _Alignas(SIM_CACHE_LINE) DRONE_T drone;
+    SIM_STATE_T state; // published to the host after every step
+#if TELEMETRY_ENABLED
+    // filter telemetry, drained in bulk by the host through telemetry_drain
+    TELEMETRY_RING_T telemetry;
+    TELEMETRY_RECORD_T telemetryDrain[TELEMETRY_CAPACITY];
+#endif
+    ARENA_T scratch;
+    _Alignas(ARENA_ALIGN) unsigned char scratchBuffer[SIM_SCRATCH_BYTES];
+};
+
+static SIM_T simDefault;
+
+// linear memory the host fills for sim_step_n on the default instance
+static float simStepTargets[SIM_STEP_N_CAPACITY * 2];
+static float simStepOutputs[SIM_STEP_N_CAPACITY * SIM_STEP_OUTPUT_FLOATS];
+
+
+// P_update is propagated lazily between GNSS updates, its diagonal is the one
+// of the last update. flushing it every step would undo that
+static void simPublishState(SIM_T* sim, float targetPos_x, float targetPos_y)
+{
+    DRONE_T* drone = &(sim->drone);
+    SIM_STATE_T* state = &(sim->state);
+
+    state->version = SIM_STATE_VERSION;
+    state->floats = SIM_STATE_FLOATS;
+    state->step = drone->sensors.step;
+    state->time = drone->sensors.step * drone->dt;
+
+    state->truth[0] = drone->states.pos.x;
+    state->truth[1] = drone->states.pos.y;
+    state->truth[2] = drone->states.angle;
+    state->truth[3] = drone->states.vel.x;
+    state->truth[4] = drone->states.vel.y;
+    state->truth[5] = drone->states.angular_vel;
+
+    state->estimate[0] = drone->estimation.pos.x;
+    state->estimate[1] = drone->estimation.pos.y;
+    state->estimate[2] = drone->estimation.angle;
+    state->estimate[3] = drone->estimation.vel.x;
+    state->estimate[4] = drone->estimation.vel.y;
+
+    state->gnss[0] = drone->sensors.GNSS_pos.x;
+    state->gnss[1] = drone->sensors.GNSS_pos.y;
+    state->gnss[2] = drone->sensors.GNSS_vel.x;
+    state->gnss[3] = drone->sensors.GNSS_vel.y;
+
+    for(int iter = 0; iter < 5; iter++)
+    {
+        state->Pdiag[iter] = sym5Get(&(drone->estimation.kalman.P_update), iter, iter);
+    }
 
-DRONE_T drone;
+    state->effectors[0] = drone->effectors.left;
+    state->effectors[1] = drone->effectors.right;
+    state->target[0] = targetPos_x;
+    state->target[1] = targetPos_y;
+}
 
-// CONSTANTS ----------
-float gravity = 9.81;
-int counter = 0;
-int gps_flag = 0;
+// sim has to be zeroed
+static void simInit(SIM_T* sim, float dt, unsigned int seed, unsigned int id)
+{
+    DRONE_T* drone = &(sim->drone);
 
+    drone->dt = dt;
+    drone->seed = seed;
+    drone->id = id;
+    drone->airframe.mass = 0.25; //250g
+    drone->airframe.inertia = 5 * 1e-5;
+    drone->airframe.propDist = 0.127/2; //127mm cg to motor center
+    drone->airframe.maxThrust = 3; //3N per prop
 
 
-uint8_t sim_init(float dt);
-void    sim_step(float thr, float steer);
-float   drone_get_x(void);
-float   drone_get_y(void);
-float   drone_get_angle(void);
+    setupSensors(drone);
+    setupEstimation(drone);
 
+    arenaInit(&(sim->scratch), sim->scratchBuffer, sizeof(sim->scratchBuffer));
+    drone->estimation.kalman.scratch = &(sim->scratch);
 
-uint8_t sim_init(float dt)
+#if TELEMETRY_ENABLED
+    telemetryInit(&(sim->telemetry));
+    drone->estimation.kalman.telemetry = &(sim->telemetry);
+#endif
+
+#ifdef SIM_KALMAN_STEADY_STATE
+    // model and GNSS cadence are fixed, run the filter on the cached periodic gain
+    kalmanEnableSteadyState(&(drone->estimation.kalman), drone->sensors.rate[SENSOR_GNSS_POS].period);
+#endif
+
+    simPublishState(sim, 0, 0);
+}
+
+static void simStep(SIM_T* sim, float targetPos_x, float targetPos_y)
 {
-    srand(0);
+    DRONE_T* drone = &(sim->drone);
 
-    drone.dt = dt;
-    drone.airframe.mass = 0.25; //250g
-    drone.airframe.inertia = 5 * 1e-5;
-    drone.airframe.propDist = 0.127/2; //127mm cg to motor center
-    drone.airframe.maxThrust = 3; //3N per prop
+    VEC2D_T targetPos;
+    targetPos.x = targetPos_x;
+    targetPos.y = targetPos_y;
+
+
+    DRONE_EFFECTORS_T effector = dronePositionController(targetPos, drone);
+    drone->effectors = effector;
+
+    droneDynamicStep(drone, effector.left, effector.right);
+    
+    // sensors sample on their own schedule, the estimator updates on what arrived
+    unsigned char zMask = droneSensorsStep(drone);
 
+    attitudeComplementaryFilter(drone);
 
-    setupKalman(dt);
+    pos_vel_estimate(drone, zMask);
+
+    simPublishState(sim, targetPos_x, targetPos_y);
+
+    arenaReset(&(sim->scratch));
+}
+
+static void simRecordOutput(SIM_T* sim, float* out)
+{
+    DRONE_T* drone = &(sim->drone);
+
+    out[0] = drone->states.pos.x;
+    out[1] = drone->states.pos.y;
+    out[2] = drone->states.angle;
+    out[3] = drone->estimation.pos.x;
+    out[4] = drone->estimation.pos.y;
+    out[5] = drone->estimation.angle;
+    out[6] = drone->sensors.GNSS_pos.x;
+    out[7] = drone->sensors.GNSS_pos.y;
+}
+
+
+// INSTANCES ----------
+// returns NULL if the allocation fails
+SIM_EXPORT
+SIM_T* sim_create(float dt, unsigned int seed, unsigned int id)
+{
+    SIM_T* sim = simAlignedAlloc(SIM_CACHE_LINE, sizeof(SIM_T));
+    if(sim == NULL)
+    {
+        return NULL;
+    }
+
+    memset(sim, 0, sizeof(SIM_T));
+    simInit(sim, dt, seed, id);
+    return sim;
+}
+
+SIM_EXPORT
+void sim_destroy(SIM_T* sim)
+{
+    if(sim != NULL && sim != &simDefault)
+    {
+        simAlignedFree(sim);
+    }
+}
+
+SIM_EXPORT
+void sim_instance_step(SIM_T* sim, float targetPos_x, float targetPos_y)
+{
+    simStep(sim, targetPos_x, targetPos_y);
+}
+
+// n steps in one call, returns the number of steps taken
+SIM_EXPORT
+int sim_instance_step_n(SIM_T* sim, int n, const float* targets, float* outputs)
+{
+    for(int iter = 0; iter < n; iter++)
+    {
+        simStep(sim, targets[2 * iter], targets[2 * iter + 1]);
+
+        if(outputs != NULL)
+        {
+            simRecordOutput(sim, outputs + iter * SIM_STEP_OUTPUT_FLOATS);
+        }
+    }
+
+    // the step scratch is empty whenever control returns to the host
+    arenaReset(&(sim->scratch));
+    return n > 0 ? n : 0;
+}
+
+SIM_EXPORT
+float sim_instance_get_x(SIM_T* sim)
+{
+    return sim->drone.states.pos.x;
+}
+
+SIM_EXPORT
+float sim_instance_get_y(SIM_T* sim)
+{
+    return sim->drone.states.pos.y;
+}
+
+SIM_EXPORT
+float sim_instance_get_angle(SIM_T* sim)
+{
+    return sim->drone.states.angle;
+}
+
+SIM_EXPORT
+float sim_instance_get_x_estimate(SIM_T* sim)
+{
+    return sim->drone.estimation.pos.x;
+}
+
+SIM_EXPORT
+float sim_instance_get_y_estimate(SIM_T* sim)
+{
+    return sim->drone.estimation.pos.y;
+}
+
+SIM_EXPORT
+float sim_instance_get_angle_estimate(SIM_T* sim)
+{
+    return sim->drone.estimation.angle;
+}
+
+SIM_EXPORT
+float sim_instance_get_gnss_x(SIM_T* sim)
+{
+    return sim->drone.sensors.GNSS_pos.x;
+}
+
+SIM_EXPORT
+float sim_instance_get_gnss_y(SIM_T* sim)
+{
+    return sim->drone.sensors.GNSS_pos.y;
+}
+
+// telemetry_drain moves the pending records into one contiguous buffer and
+// returns how many there are, the host then reads
+// count * telemetry_record_floats() floats from telemetry_buffer()
+SIM_EXPORT
+int sim_instance_telemetry_drain(SIM_T* sim)
+{
+#if TELEMETRY_ENABLED
+    return telemetryDrain(&(sim->telemetry), sim->telemetryDrain, TELEMETRY_CAPACITY);
+#else
+    return 0;
+#endif
+}
+
+SIM_EXPORT
+float* sim_instance_telemetry_buffer(SIM_T* sim)
+{
+#if TELEMETRY_ENABLED
+    return (float*)sim->telemetryDrain;
+#else
+    return NULL;
+#endif
+}
+
+SIM_EXPORT
+int sim_instance_telemetry_dropped(SIM_T* sim)
+{
+#if TELEMETRY_ENABLED
+    return (int)sim->telemetry.dropped;
+#else
+    return 0;
+#endif
+}
+
+SIM_EXPORT
+SIM_STATE_T* sim_instance_state(SIM_T* sim)
+{
+    return &(sim->state);
+}
+
+// not exported to JS, native tools (the benchmarks) run on the model
+DRONE_T* sim_instance_drone(SIM_T* sim)
+{
+    return &(sim->drone);
+}
+
+
+// DEFAULT INSTANCE ----------
+
+uint8_t sim_init(float dt)
+{
+    memset(&simDefault, 0, sizeof(simDefault));
+    simInit(&simDefault, dt, SIM_NOISE_SEED, 0);
 
 
     // test matrix stuff
@@ -107,85 +379,113 @@ uint8_t sim_init(float dt)
 
 void sim_step(float targetPos_x, float targetPos_y)
 {
+    simStep(&simDefault, targetPos_x, targetPos_y);
+}
 
-    counter++;
-
-    VEC2D_T targetPos;
-    targetPos.x = targetPos_x;
-    targetPos.y = targetPos_y;
-
-
-    DRONE_EFFECTORS_T effector = dronePositionController(targetPos, &drone);
-
-    droneDynamicStep(&drone, effector.left, effector.right);
-    
-    accelerometerMeasurement(&drone);
-    gyroscopeMeasurement(&drone);
-
-
-
-    attitudeComplementaryFilter(&drone);
-
-    if(counter>10)
-    {
-        counter = 0;
+// the host writes up to sim_step_capacity() target pairs into
+// sim_step_targets() and passes both buffers (or any others in linear memory)
+SIM_EXPORT
+int sim_step_n(int n, const float* targets, float* outputs)
+{
+    return sim_instance_step_n(&simDefault, n, targets, outputs);
+}
 
-        GNSSMeasurement_position(&drone);
-        GNSSMeasurement_velocity(&drone);
+SIM_EXPORT
+float* sim_step_targets()
+{
+    return simStepTargets;
+}
 
-        pos_vel_estimate(&drone, 1);
-    }
-    else
-    {
-        pos_vel_estimate(&drone, 0);
-    }
+SIM_EXPORT
+float* sim_step_outputs()
+{
+    return simStepOutputs;
+}
 
-    
-    
+SIM_EXPORT
+int sim_step_capacity()
+{
+    return SIM_STEP_N_CAPACITY;
+}
 
-    
+SIM_EXPORT
+int sim_step_output_floats()
+{
+    return SIM_STEP_OUTPUT_FLOATS;
+}
 
+// the block stays at this address for the lifetime of the module
+SIM_EXPORT
+SIM_STATE_T* sim_state_ptr()
+{
+    return sim_instance_state(&simDefault);
 }
 
 float drone_get_x()
 {
-    return drone.states.pos.x;
+    return sim_instance_get_x(&simDefault);
 }
 
 float drone_get_y()
 {
-    return drone.states.pos.y;
+    return sim_instance_get_y(&simDefault);
 }
 
 float drone_get_angle()
 {
-    return drone.states.angle;
+    return sim_instance_get_angle(&simDefault);
 }
 
 float drone_get_x_estimate()
 {
-    return drone.estimation.pos.x;
+    return sim_instance_get_x_estimate(&simDefault);
 }
 
 float drone_get_y_estimate()
 {
-    return drone.estimation.pos.y;
+    return sim_instance_get_y_estimate(&simDefault);
 }
 
-EMSCRIPTEN_KEEPALIVE
+SIM_EXPORT
 float drone_get_angle_estimate()
 {
-    return drone.estimation.angle;
+    return sim_instance_get_angle_estimate(&simDefault);
 }
 
-EMSCRIPTEN_KEEPALIVE
+SIM_EXPORT
 float drone_get_gnss_x()
 {
-    return drone.sensors.GNSS_pos.x;
+    return sim_instance_get_gnss_x(&simDefault);
 }
 
-EMSCRIPTEN_KEEPALIVE
+SIM_EXPORT
 float drone_get_gnss_y()
 {
-    return drone.sensors.GNSS_pos.y;
-}
\ No newline at end of file
+    return sim_instance_get_gnss_y(&simDefault);
+}
+
+
+// TELEMETRY ----------
+SIM_EXPORT
+int telemetry_drain()
+{
+    return sim_instance_telemetry_drain(&simDefault);
+}
+
+SIM_EXPORT
+float* telemetry_buffer()
+{
+    return sim_instance_telemetry_buffer(&simDefault);
+}
+
+SIM_EXPORT
+int telemetry_record_floats()
+{
+    return (int)TELEMETRY_RECORD_FLOATS;
+}
+
+SIM_EXPORT
+int telemetry_dropped()
+{
+    return sim_instance_telemetry_dropped(&simDefault);
+}
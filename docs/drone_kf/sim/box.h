@@ -0,0 +1,62 @@
+#ifndef BOX_H
+#define BOX_H
+
+#include <stdint.h>
+#include "simState.h"
+#include "drone.h"
+
+// host facing API of the simulation, exported to JS in the wasm build and
+// called directly by the native runner.
+//
+// every simulation is a SIM_T instance, created with sim_create and driven
+// through its handle. sim_init / sim_step / drone_get_* / telemetry_* work on
+// a static default instance and keep the original single drone API.
+
+typedef struct SIM SIM_T;
+
+// bulk stepping. targets holds n (x, y) pairs, one per step. outputs, if not
+// NULL, receives SIM_STEP_OUTPUT_FLOATS floats per step:
+// x, y, angle, x_estimate, y_estimate, angle_estimate, gnss_x, gnss_y
+#define SIM_STEP_OUTPUT_FLOATS 8
+#define SIM_STEP_N_CAPACITY    64 // steps held by sim_step_targets / sim_step_outputs
+
+SIM_T*  sim_create(float dt, unsigned int seed, unsigned int id);
+void    sim_destroy(SIM_T* sim);
+void    sim_instance_step(SIM_T* sim, float targetPos_x, float targetPos_y);
+int     sim_instance_step_n(SIM_T* sim, int n, const float* targets, float* outputs);
+float   sim_instance_get_x(SIM_T* sim);
+float   sim_instance_get_y(SIM_T* sim);
+float   sim_instance_get_angle(SIM_T* sim);
+float   sim_instance_get_x_estimate(SIM_T* sim);
+float   sim_instance_get_y_estimate(SIM_T* sim);
+float   sim_instance_get_angle_estimate(SIM_T* sim);
+float   sim_instance_get_gnss_x(SIM_T* sim);
+float   sim_instance_get_gnss_y(SIM_T* sim);
+int     sim_instance_telemetry_drain(SIM_T* sim);
+float*  sim_instance_telemetry_buffer(SIM_T* sim);
+int     sim_instance_telemetry_dropped(SIM_T* sim);
+SIM_STATE_T* sim_instance_state(SIM_T* sim);
+DRONE_T* sim_instance_drone(SIM_T* sim);
+
+uint8_t sim_init(float dt);
+void    sim_step(float targetPos_x, float targetPos_y);
+int     sim_step_n(int n, const float* targets, float* outputs);
+float*  sim_step_targets(void);
+float*  sim_step_outputs(void);
+int     sim_step_capacity(void);
+int     sim_step_output_floats(void);
+SIM_STATE_T* sim_state_ptr(void);
+float   drone_get_x(void);
+float   drone_get_y(void);
+float   drone_get_angle(void);
+float   drone_get_x_estimate(void);
+float   drone_get_y_estimate(void);
+float   drone_get_angle_estimate(void);
+float   drone_get_gnss_x(void);
+float   drone_get_gnss_y(void);
+int     telemetry_drain(void);
+float*  telemetry_buffer(void);
+int     telemetry_record_floats(void);
+int     telemetry_dropped(void);
+
+#endif
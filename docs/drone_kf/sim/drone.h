@@ -1,6 +1,10 @@
 #ifndef DRONE_H
 #define DRONE_H
 
+#include "kalman.h"
+#include "measurementQueue.h"
+#include "rng.h"
+
 typedef struct{
     float x;
     float y;
@@ -27,17 +31,35 @@ typedef struct{
     float propDist;
 } DRONE_AIRFRAME_T;
 
+// sensor ids, index into DRONE_SENSORS_T.rate and tag of queued measurements.
+// sampled in this order every step, which keeps the noise sequence fixed
+#define SENSOR_ACCELEROMETER 0
+#define SENSOR_GYROSCOPE     1
+#define SENSOR_GNSS_POS      2
+#define SENSOR_GNSS_VEL      3
+#define SENSOR_COUNT         4
+
 typedef struct{
+    // latest reading that has arrived of each sensor
     VEC2D_T accelerometer;
     float gyroscope;
     VEC2D_T GNSS_pos;
     VEC2D_T GNSS_vel;
+
+    SENSOR_RATE_T rate[SENSOR_COUNT];
+    MEASUREMENT_QUEUE_T queue; // sampled, not yet arrived
+    MEASUREMENT_T delayed[MEASUREMENT_QUEUE_CAPACITY]; // GNSS that arrived this step but was sampled earlier
+    int delayedCount;
+    unsigned int step;         // sensor clock, sim steps since setupSensors
+    RNG_STREAM_T noise;        // keyed by (seed, id) of the drone
+    RNG_NOISE_BUFFER_T noiseBuffer[SENSOR_COUNT]; // upcoming noise of each sensor
 } DRONE_SENSORS_T;
 
 typedef struct{
     float angle;
     VEC2D_T pos;
     VEC2D_T vel;
+    KALMAN_T kalman; // position / velocity filter of this drone
 } DRONE_ESTIMATION_T;
 
 typedef struct{
@@ -47,6 +69,8 @@ typedef struct{
     DRONE_SENSORS_T sensors;
     DRONE_ESTIMATION_T estimation;
     float dt;
+    unsigned int seed; // noise seed of the run
+    unsigned int id;   // entity id, separates the noise streams of drones in one run
 } DRONE_T;
 
 
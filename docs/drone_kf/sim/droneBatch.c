@@ -0,0 +1,197 @@
+#include "droneBatch.h"
+#include "integrator.h"
+#include <math.h>
+#include "fastMath.h"
+
+// count drones stepped with dt, the arrays come from the arena.
+// returns 1 if the arena is too small
+int droneBatchInit(DRONE_BATCH_T* batch, ARENA_T* arena, int count, float dt)
+{
+    float** fields[] = {
+        &batch->pos_x, &batch->pos_y, &batch->vel_x, &batch->vel_y,
+        &batch->angle, &batch->angular_vel,
+        &batch->accel_x, &batch->accel_y, &batch->angular_acc,
+        &batch->mass, &batch->inertia, &batch->maxThrust, &batch->propDist,
+        &batch->left, &batch->right
+    };
+
+    batch->count = count;
+    batch->dt = dt;
+
+    for(int iter = 0; iter < (int)(sizeof(fields) / sizeof(fields[0])); iter++)
+    {
+        *fields[iter] = arenaAlloc(arena, sizeof(float) * (count > 0 ? count : 1));
+        if(!*fields[iter]){return 1;}
+        for(int drone = 0; drone < count; drone++)
+        {
+            (*fields[iter])[drone] = 0;
+        }
+    }
+
+    return 0;
+}
+
+// copies airframe, states and effectors of one drone in or out of the batch
+void droneBatchSet(DRONE_BATCH_T* batch, int index, DRONE_T* drone)
+{
+    batch->pos_x[index]       = drone->states.pos.x;
+    batch->pos_y[index]       = drone->states.pos.y;
+    batch->vel_x[index]       = drone->states.vel.x;
+    batch->vel_y[index]       = drone->states.vel.y;
+    batch->angle[index]       = drone->states.angle;
+    batch->angular_vel[index] = drone->states.angular_vel;
+    batch->accel_x[index]     = drone->states.accel.x;
+    batch->accel_y[index]     = drone->states.accel.y;
+    batch->angular_acc[index] = drone->states.angular_acc;
+
+    batch->mass[index]      = drone->airframe.mass;
+    batch->inertia[index]   = drone->airframe.inertia;
+    batch->maxThrust[index] = drone->airframe.maxThrust;
+    batch->propDist[index]  = drone->airframe.propDist;
+
+    batch->left[index]  = drone->effectors.left;
+    batch->right[index] = drone->effectors.right;
+}
+
+void droneBatchGet(DRONE_BATCH_T* batch, int index, DRONE_T* drone)
+{
+    drone->states.pos.x       = batch->pos_x[index];
+    drone->states.pos.y       = batch->pos_y[index];
+    drone->states.vel.x       = batch->vel_x[index];
+    drone->states.vel.y       = batch->vel_y[index];
+    drone->states.angle       = batch->angle[index];
+    drone->states.angular_vel = batch->angular_vel[index];
+    drone->states.accel.x     = batch->accel_x[index];
+    drone->states.accel.y     = batch->accel_y[index];
+    drone->states.angular_acc = batch->angular_acc[index];
+
+    drone->effectors.left  = batch->left[index];
+    drone->effectors.right = batch->right[index];
+}
+
+// same expressions as droneAccel, so the results are identical
+void droneBatchCalcAccel(DRONE_BATCH_T* batch)
+{
+    int n = batch->count;
+
+    // sincos 4 drones at a time, fastSinCos4 matches fastSinCos exactly
+    int iter = 0;
+    for(; iter + 4 <= n; iter += 4)
+    {
+        float s[4], c[4];
+        fastSinCos4(batch->angle + iter, s, c);
+
+        for(int lane = 0; lane < 4; lane++)
+        {
+            float acc_b = (batch->left[iter + lane] + batch->right[iter + lane]) * batch->maxThrust[iter + lane] / batch->mass[iter + lane];
+
+            batch->accel_x[iter + lane] = -s[lane] * acc_b;
+            batch->accel_y[iter + lane] =  c[lane] * acc_b - GRAVITY;
+        }
+    }
+    for(; iter < n; iter++)
+    {
+        float s, c;
+        fastSinCos(batch->angle[iter], &s, &c);
+
+        float acc_b = (batch->left[iter] + batch->right[iter]) * batch->maxThrust[iter] / batch->mass[iter];
+
+        batch->accel_x[iter] = -s * acc_b;
+        batch->accel_y[iter] =  c * acc_b - GRAVITY;
+    }
+
+    for(iter = 0; iter < n; iter++)
+    {
+        batch->angular_acc[iter] = (batch->right[iter] - batch->left[iter]) * batch->maxThrust[iter] * batch->propDist[iter] / batch->inertia[iter];
+    }
+}
+
+#if SIM_INTEGRATOR == INTEGRATOR_VERLET || SIM_INTEGRATOR == INTEGRATOR_RK4
+
+// the multi stage schemes evaluate the acceleration inside the step,
+// those run the scalar integrator per drone on the batch arrays
+typedef struct{
+    DRONE_BATCH_T* batch;
+    int index;
+} DRONE_BATCH_CTX_T;
+
+static void droneBatchAccel(float* a, float* q, float* v, void* ctx)
+{
+    DRONE_BATCH_CTX_T* c = (DRONE_BATCH_CTX_T*)ctx;
+    DRONE_BATCH_T* batch = c->batch;
+    int i = c->index;
+    (void)v;
+
+    float acc_b = (batch->left[i] + batch->right[i]) * batch->maxThrust[i] / batch->mass[i];
+
+    float sinAngle, cosAngle;
+    fastSinCos(q[2], &sinAngle, &cosAngle);
+    a[0] = -sinAngle * acc_b;
+    a[1] =  cosAngle * acc_b - GRAVITY;
+    a[2] = (batch->right[i] - batch->left[i]) * batch->maxThrust[i] * batch->propDist[i] / batch->inertia[i];
+}
+
+#endif
+
+// one step of every drone with its left / right effectors, same scheme as droneDynamicStep
+void droneBatchDynamicStep(DRONE_BATCH_T* batch)
+{
+    int n = batch->count;
+    float dt = batch->dt;
+
+    droneBatchCalcAccel(batch);
+
+#if SIM_INTEGRATOR == INTEGRATOR_CONST_ACCEL
+
+    // one loop per array pair, no dependencies between drones
+    for(int iter = 0; iter < n; iter++)
+    {
+        batch->pos_x[iter] = batch->pos_x[iter] + batch->vel_x[iter] * dt + 0.5 * batch->accel_x[iter] * dt * dt;
+        batch->pos_y[iter] = batch->pos_y[iter] + batch->vel_y[iter] * dt + 0.5 * batch->accel_y[iter] * dt * dt;
+        batch->angle[iter] = batch->angle[iter] + batch->angular_vel[iter] * dt + 0.5 * batch->angular_acc[iter] * dt * dt;
+    }
+    for(int iter = 0; iter < n; iter++)
+    {
+        batch->vel_x[iter]       = batch->vel_x[iter]       + batch->accel_x[iter]     * dt;
+        batch->vel_y[iter]       = batch->vel_y[iter]       + batch->accel_y[iter]     * dt;
+        batch->angular_vel[iter] = batch->angular_vel[iter] + batch->angular_acc[iter] * dt;
+    }
+
+#elif SIM_INTEGRATOR == INTEGRATOR_SEMI_IMPLICIT
+
+    for(int iter = 0; iter < n; iter++)
+    {
+        batch->vel_x[iter]       = batch->vel_x[iter]       + batch->accel_x[iter]     * dt;
+        batch->vel_y[iter]       = batch->vel_y[iter]       + batch->accel_y[iter]     * dt;
+        batch->angular_vel[iter] = batch->angular_vel[iter] + batch->angular_acc[iter] * dt;
+    }
+    for(int iter = 0; iter < n; iter++)
+    {
+        batch->pos_x[iter] = batch->pos_x[iter] + batch->vel_x[iter]       * dt;
+        batch->pos_y[iter] = batch->pos_y[iter] + batch->vel_y[iter]       * dt;
+        batch->angle[iter] = batch->angle[iter] + batch->angular_vel[iter] * dt;
+    }
+
+#else
+
+    for(int iter = 0; iter < n; iter++)
+    {
+        DRONE_BATCH_CTX_T ctx = {batch, iter};
+        INTEGRATOR_STATE_T s = {
+            {batch->pos_x[iter], batch->pos_y[iter], batch->angle[iter]},
+            {batch->vel_x[iter], batch->vel_y[iter], batch->angular_vel[iter]}
+        };
+        float a0[INTEGRATOR_DIM] = {batch->accel_x[iter], batch->accel_y[iter], batch->angular_acc[iter]};
+
+        integratorStep(&s, a0, droneBatchAccel, &ctx, dt);
+
+        batch->pos_x[iter]       = s.q[0];
+        batch->pos_y[iter]       = s.q[1];
+        batch->angle[iter]       = s.q[2];
+        batch->vel_x[iter]       = s.v[0];
+        batch->vel_y[iter]       = s.v[1];
+        batch->angular_vel[iter] = s.v[2];
+    }
+
+#endif
+}
@@ -0,0 +1,44 @@
+#ifndef DRONE_BATCH_H
+#define DRONE_BATCH_H
+
+#include "drone.h"
+#include "arena.h"
+
+// many drones stepped together, structure of arrays. every field is one
+// contiguous float array indexed by drone, so the kernels run over straight
+// arrays and vectorize. only the dynamics live here, sensors and estimation
+// stay per DRONE_T. results match droneDynamicStep bit for bit.
+
+typedef struct{
+    int count;
+    float dt;
+
+    // states
+    float* pos_x;
+    float* pos_y;
+    float* vel_x;
+    float* vel_y;
+    float* angle;
+    float* angular_vel;
+    float* accel_x;
+    float* accel_y;
+    float* angular_acc;
+
+    // airframe
+    float* mass;
+    float* inertia;
+    float* maxThrust;
+    float* propDist;
+
+    // effectors, inputs of the next step
+    float* left;
+    float* right;
+} DRONE_BATCH_T;
+
+int  droneBatchInit(DRONE_BATCH_T* , ARENA_T* , int , float );
+void droneBatchSet(DRONE_BATCH_T* , int , DRONE_T* );
+void droneBatchGet(DRONE_BATCH_T* , int , DRONE_T* );
+void droneBatchCalcAccel(DRONE_BATCH_T* );
+void droneBatchDynamicStep(DRONE_BATCH_T* );
+
+#endif
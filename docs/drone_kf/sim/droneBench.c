@@ -0,0 +1,264 @@
+#include "droneBench.h"
+#include "droneDynamics.h"
+#include "droneBatch.h"
+#include "integrator.h"
+#include "nrnd.h"
+#include "fastMath.h"
+#include <math.h>
+#include <time.h>
+
+// collective and differential input around hover, constant over each hold window
+static void benchInputs(DRONE_T* model, int window, float* left, float* right)
+{
+    float t = window * DRONE_BENCH_INPUT_HOLD;
+    float hover = model->airframe.mass * GRAVITY / (2 * model->airframe.maxThrust);
+    float collective = hover * (1 + 0.05f * sinf(2 * PI * 0.2f * t));
+    float differential = 0.0005f * sinf(2 * PI * 0.5f * t);
+
+    *left = collective - differential;
+    *right = collective + differential;
+}
+
+// droneAccel in double for the reference
+static void benchAccelDouble(double* a, double* q, DRONE_T* model, float left, float right)
+{
+    double acc_b = (double)(left + right) * model->airframe.maxThrust / model->airframe.mass;
+
+    a[0] = -sin(q[2]) * acc_b;
+    a[1] =  cos(q[2]) * acc_b - GRAVITY;
+    a[2] = (double)(right - left) * model->airframe.maxThrust * model->airframe.propDist / model->airframe.inertia;
+}
+
+// reference, RK4 in double at a fine step so float rounding of the long
+// run does not swamp the errors being measured
+static void benchReference(DRONE_T* model, int windows, float* trace)
+{
+    double q[3] = {0, 0, 0};
+    double v[3] = {0, 0, 0};
+    double dt = (double)DRONE_BENCH_INPUT_HOLD / DRONE_BENCH_REF_SUBSTEPS;
+    float left, right;
+
+    for(int window = 0; window < windows; window++)
+    {
+        benchInputs(model, window, &left, &right);
+        for(int step = 0; step < DRONE_BENCH_REF_SUBSTEPS; step++)
+        {
+            double k1[3], k2[3], k3[3], k4[3], qs[3];
+            double v2[3], v3[3], v4[3];
+
+            benchAccelDouble(k1, q, model, left, right);
+            for(int iter = 0; iter < 3; iter++){qs[iter] = q[iter] + 0.5 * dt * v[iter]; v2[iter] = v[iter] + 0.5 * dt * k1[iter];}
+            benchAccelDouble(k2, qs, model, left, right);
+            for(int iter = 0; iter < 3; iter++){qs[iter] = q[iter] + 0.5 * dt * v2[iter]; v3[iter] = v[iter] + 0.5 * dt * k2[iter];}
+            benchAccelDouble(k3, qs, model, left, right);
+            for(int iter = 0; iter < 3; iter++){qs[iter] = q[iter] + dt * v3[iter]; v4[iter] = v[iter] + dt * k3[iter];}
+            benchAccelDouble(k4, qs, model, left, right);
+
+            for(int iter = 0; iter < 3; iter++)
+            {
+                q[iter] += dt / 6 * (v[iter] + 2 * v2[iter] + 2 * v3[iter] + v4[iter]);
+                v[iter] += dt / 6 * (k1[iter] + 2 * k2[iter] + 2 * k3[iter] + k4[iter]);
+            }
+        }
+        trace[3 * window + 0] = (float)q[0];
+        trace[3 * window + 1] = (float)q[1];
+        trace[3 * window + 2] = (float)q[2];
+    }
+}
+
+// flies the input script with one scheme, records q at the end of every
+// window into trace (3 floats each), returns the wall time in seconds
+#define BENCH_RUN(name, step) \
+    static double name(DRONE_T* model, float dt, int windows, float* trace) \
+    { \
+        int substeps = (int)(DRONE_BENCH_INPUT_HOLD / dt + 0.5f); \
+        INTEGRATOR_STATE_T s = {{0, 0, 0}, {0, 0, 0}}; \
+        DRONE_ACCEL_CTX_T ctx = {model, 0, 0}; \
+        float a0[INTEGRATOR_DIM]; \
+        clock_t start = clock(); \
+        for(int window = 0; window < windows; window++) \
+        { \
+            benchInputs(model, window, &ctx.left, &ctx.right); \
+            for(int iter = 0; iter < substeps; iter++) \
+            { \
+                droneAccel(a0, s.q, s.v, &ctx); \
+                step(&s, a0, droneAccel, &ctx, dt); \
+            } \
+            trace[3 * window + 0] = s.q[0]; \
+            trace[3 * window + 1] = s.q[1]; \
+            trace[3 * window + 2] = s.q[2]; \
+        } \
+        return (double)(clock() - start) / CLOCKS_PER_SEC; \
+    }
+
+BENCH_RUN(benchConstAccel,  integratorStepConstAccel)
+BENCH_RUN(benchSemiImplicit, integratorStepSemiImplicit)
+BENCH_RUN(benchVerlet,      integratorStepVerlet)
+BENCH_RUN(benchRK4,         integratorStepRK4)
+
+// runs every scheme at dt over duration seconds of the input script, timing
+// is the best of repeats runs. model supplies the airframe. fills one result
+// per scheme and returns how many, 0 if dt does not divide the input hold
+int droneIntegratorBench(DRONE_T* model, float dt, float duration, int repeats, DRONE_BENCH_RESULT_T* out)
+{
+    static float reference[3 * DRONE_BENCH_MAX_SAMPLES];
+    static float trace[3 * DRONE_BENCH_MAX_SAMPLES];
+
+    int substeps = (int)(DRONE_BENCH_INPUT_HOLD / dt + 0.5f);
+    if(substeps < 1 || fabsf(substeps * dt - DRONE_BENCH_INPUT_HOLD) > 1e-6f)
+    {
+        return 0;
+    }
+
+    int windows = (int)(duration / DRONE_BENCH_INPUT_HOLD);
+    if(windows > DRONE_BENCH_MAX_SAMPLES){windows = DRONE_BENCH_MAX_SAMPLES;}
+    if(repeats < 1){repeats = 1;}
+
+    benchReference(model, windows, reference);
+
+    for(int scheme = 0; scheme < DRONE_BENCH_SCHEMES; scheme++)
+    {
+        double best = 0;
+        for(int run = 0; run < repeats; run++)
+        {
+            double seconds = 0;
+            switch(scheme)
+            {
+                case INTEGRATOR_CONST_ACCEL:   seconds = benchConstAccel(model, dt, windows, trace); break;
+                case INTEGRATOR_SEMI_IMPLICIT: seconds = benchSemiImplicit(model, dt, windows, trace); break;
+                case INTEGRATOR_VERLET:        seconds = benchVerlet(model, dt, windows, trace); break;
+                case INTEGRATOR_RK4:           seconds = benchRK4(model, dt, windows, trace); break;
+            }
+            if(run == 0 || seconds < best){best = seconds;}
+        }
+
+        float posErr = 0;
+        float angleErr = 0;
+        for(int window = 0; window < windows; window++)
+        {
+            float dx = trace[3 * window + 0] - reference[3 * window + 0];
+            float dy = trace[3 * window + 1] - reference[3 * window + 1];
+            float da = fabsf(trace[3 * window + 2] - reference[3 * window + 2]);
+            float d = sqrtf(dx * dx + dy * dy);
+            if(d > posErr){posErr = d;}
+            if(da > angleErr){angleErr = da;}
+        }
+
+        out[scheme].scheme = scheme;
+        out[scheme].dt = dt;
+        out[scheme].posErrorMax = posErr;
+        out[scheme].angleErrorMax = angleErr;
+        out[scheme].nsPerStep = (float)(best * 1e9 / ((double)windows * substeps));
+    }
+
+    return DRONE_BENCH_SCHEMES;
+}
+
+// per drone effectors, spread around hover so the drones do not fly in lockstep
+static void benchBatchInputs(DRONE_T* model, int index, float* left, float* right)
+{
+    float hover = model->airframe.mass * GRAVITY / (2 * model->airframe.maxThrust);
+    float spread = (float)((index * 37) % 101) / 100.0f - 0.5f;
+
+    *left = hover * (1 + 0.02f * spread) - 0.0002f * spread;
+    *right = hover * (1 + 0.02f * spread) + 0.0002f * spread;
+}
+
+// steps drones copies of model for steps steps in a batch and one by one
+// through droneDynamicStep, with the batch arrays taken from arena.
+// returns 1 if the arena is too small
+int droneBatchBench(DRONE_T* model, ARENA_T* arena, int drones, int steps, DRONE_BATCH_BENCH_T* out)
+{
+    DRONE_BATCH_T batch;
+    size_t mark = arenaMark(arena);
+
+    if(droneBatchInit(&batch, arena, drones, model->dt))
+    {
+        arenaRelease(arena, mark);
+        return 1;
+    }
+
+    for(int index = 0; index < drones; index++)
+    {
+        benchBatchInputs(model, index, &(model->effectors.left), &(model->effectors.right));
+        droneBatchSet(&batch, index, model);
+    }
+
+    clock_t start = clock();
+    for(int step = 0; step < steps; step++)
+    {
+        droneBatchDynamicStep(&batch);
+    }
+    double batchSeconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    // scalar path, each drone run to the end from the same start
+    DRONE_STATES_T initial = model->states;
+    float deviation = 0;
+    double scalarSeconds = 0;
+    for(int index = 0; index < drones; index++)
+    {
+        float left, right;
+        benchBatchInputs(model, index, &left, &right);
+        model->states = initial;
+
+        start = clock();
+        for(int step = 0; step < steps; step++)
+        {
+            droneDynamicStep(model, left, right);
+        }
+        scalarSeconds += (double)(clock() - start) / CLOCKS_PER_SEC;
+
+        float diff[] = {
+            model->states.pos.x - batch.pos_x[index], model->states.pos.y - batch.pos_y[index],
+            model->states.vel.x - batch.vel_x[index], model->states.vel.y - batch.vel_y[index],
+            model->states.angle - batch.angle[index], model->states.angular_vel - batch.angular_vel[index]
+        };
+        for(int iter = 0; iter < 6; iter++)
+        {
+            if(fabsf(diff[iter]) > deviation){deviation = fabsf(diff[iter]);}
+        }
+    }
+    model->states = initial;
+
+    out->drones = drones;
+    out->steps = steps;
+    out->batchRate = (float)((double)drones * steps / (batchSeconds > 0 ? batchSeconds : 1e-9));
+    out->scalarRate = (float)((double)drones * steps / (scalarSeconds > 0 ? scalarSeconds : 1e-9));
+    out->maxDeviation = deviation;
+
+    arenaRelease(arena, mark);
+    return 0;
+}
+
+// sweeps samples angles over [-range, range] for fastSinCos and samples
+// directions at radii 1e-3, 1 and 1e3 for fastAtan2
+void droneMathAccuracy(float range, int samples, DRONE_MATH_BENCH_T* out)
+{
+    double sinCosErr = 0;
+    double atanErr = 0;
+
+    for(int iter = 0; iter <= samples; iter++)
+    {
+        float x = -range + 2 * range * (float)iter / samples;
+        float s, c;
+        fastSinCos(x, &s, &c);
+
+        double es = fabs(s - sin((double)x));
+        double ec = fabs(c - cos((double)x));
+        if(es > sinCosErr){sinCosErr = es;}
+        if(ec > sinCosErr){sinCosErr = ec;}
+
+        double t = 2 * PI * (double)iter / samples;
+        for(double radius = 1e-3; radius < 1e4; radius *= 1e3)
+        {
+            float y0 = (float)(radius * sin(t));
+            float x0 = (float)(radius * cos(t));
+            double e = fabs(fastAtan2(y0, x0) - atan2((double)y0, (double)x0));
+            if(e > PI){e = 2 * PI - e;}
+            if(e > atanErr){atanErr = e;}
+        }
+    }
+
+    out->sinCosErrorMax = (float)sinCosErr;
+    out->atan2ErrorMax = (float)atanErr;
+}
@@ -0,0 +1,42 @@
+#ifndef DRONE_BENCH_H
+#define DRONE_BENCH_H
+
+#include "drone.h"
+#include "arena.h"
+
+// accuracy vs cost of the integrators in integrator.h. every scheme flies the
+// same open loop input script and is compared against RK4 in double at a fine step
+
+#define DRONE_BENCH_INPUT_HOLD   0.04f // s, inputs change only on this grid, keep dt a divisor
+#define DRONE_BENCH_REF_SUBSTEPS 64    // reference step is DRONE_BENCH_INPUT_HOLD / this
+#define DRONE_BENCH_MAX_SAMPLES  4096  // compared points, one per input hold
+#define DRONE_BENCH_SCHEMES      4     // INTEGRATOR_* ids 0..3
+
+typedef struct{
+    int scheme;          // INTEGRATOR_*
+    float dt;
+    float posErrorMax;   // m, worst distance to the reference
+    float angleErrorMax; // rad
+    float nsPerStep;     // wall time of one integrator step incl. accelerations
+} DRONE_BENCH_RESULT_T;
+
+// throughput of droneBatchDynamicStep against droneDynamicStep per drone
+typedef struct{
+    int drones;
+    int steps;
+    float batchRate;    // drone steps per second, batch
+    float scalarRate;   // drone steps per second, one DRONE_T at a time
+    float maxDeviation; // largest state difference between the two paths
+} DRONE_BATCH_BENCH_T;
+
+// measured error of fastMath.h against double precision libm
+typedef struct{
+    float sinCosErrorMax; // absolute, angles in [-range, range]
+    float atan2ErrorMax;  // rad, full circle at several radii
+} DRONE_MATH_BENCH_T;
+
+void droneMathAccuracy(float , int , DRONE_MATH_BENCH_T* );
+int droneIntegratorBench(DRONE_T* , float , float , int , DRONE_BENCH_RESULT_T* );
+int droneBatchBench(DRONE_T* , ARENA_T* , int , int , DRONE_BATCH_BENCH_T* );
+
+#endif
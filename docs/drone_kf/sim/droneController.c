@@ -2,6 +2,7 @@
 #include "droneDynamics.h"
 #include "droneController.h"
 #include <math.h>
+#include "fastMath.h"
 #include <stdio.h>
 
 #define P_GAIN_ANGULAR_VELOCITY  40
@@ -65,15 +66,16 @@ float attitudeController(float targetAngle, float currentAngle)
 
 float targetWorldAccToTargetAtt(VEC2D_T targetAcc)
 {
-    return atan2f( -targetAcc.x, (targetAcc.y + GRAVITY) );
+    return fastAtan2( -targetAcc.x, (targetAcc.y + GRAVITY) );
 }
 
 float targetWorldAccToTargetAcc(VEC2D_T targetAcc, float targetAtt, float currentAtt)
 {
 
-    float totalAcc = sqrtf( powf(targetAcc.x,2) + powf(targetAcc.y + GRAVITY, 2) );
+    float totalAcc = fastHypot(targetAcc.x, targetAcc.y + GRAVITY);
 
-    float alignmentFactor = powf(cosf(targetAtt - currentAtt),1);
+    float alignmentSin, alignmentFactor;
+    fastSinCos(targetAtt - currentAtt, &alignmentSin, &alignmentFactor);
     if (((targetAtt - currentAtt) > (3.14/2)) || ((targetAtt - currentAtt) < (-3.14/2)))
     {
         alignmentFactor = 0;
@@ -95,14 +97,17 @@ VEC2D_T targetWorldVelToTargetWorldAcc(VEC2D_T targetVel, VEC2D_T currentVel,  D
     targetAcceleration.y = errorVelocity.y * P_GAIN_WORLD_VEL_WORLD_ACC;
 
     
-    float acc_angle = atan2f(-targetAcceleration.x, targetAcceleration.y);
-    float acc_magni = sqrtf(powf(targetAcceleration.x,2) + powf(targetAcceleration.y,2));
+    float acc_angle = fastAtan2(-targetAcceleration.x, targetAcceleration.y);
+    float acc_magni = fastHypot(targetAcceleration.x, targetAcceleration.y);
 
-    float acc_max_magni = -GRAVITY * cosf(acc_angle) + sqrtf(powf(2*(airframe->maxThrust/airframe->mass), 2) - powf(GRAVITY * sinf(acc_angle), 2));
+    float acc_sin, acc_cos;
+    fastSinCos(acc_angle, &acc_sin, &acc_cos);
+    float acc_thrust = 2*(airframe->maxThrust/airframe->mass);
+    float acc_max_magni = -GRAVITY * acc_cos + fastSqrt(acc_thrust * acc_thrust - (GRAVITY * acc_sin) * (GRAVITY * acc_sin));
 
     if (acc_magni > 0.9 * acc_max_magni){
-        targetAcceleration.x = -sinf(acc_angle) * 0.9 * acc_max_magni;
-        targetAcceleration.y =  cosf(acc_angle) * 0.9 * acc_max_magni;
+        targetAcceleration.x = -acc_sin * 0.9 * acc_max_magni;
+        targetAcceleration.y =  acc_cos * 0.9 * acc_max_magni;
 
         // printf("targetAcceleration.x: %.4f\r\n", targetAcceleration.x);
         // printf("targetAcceleration.y: %.4f\r\n", targetAcceleration.y);
@@ -138,17 +143,22 @@ VEC2D_T targetPosToTargetVelocity(VEC2D_T targetPos, VEC2D_T currentPos, DRONE_A
     // float angle     = atan2f(errorPosition.y, errorPosition.x);
     // float magnitude = sqrtf(powf(errorPosition.x,2) + powf(errorPosition.y,2));
 
-    float pos_angle = atan2f(errorPosition.y, errorPosition.x);
-    float neg_acc_angle = atan2f(errorPosition.x, -errorPosition.y);
-    float pos_magni = sqrtf(powf(errorPosition.x,2) + powf(errorPosition.y,2));
+    float pos_angle = fastAtan2(errorPosition.y, errorPosition.x);
+    float neg_acc_angle = fastAtan2(errorPosition.x, -errorPosition.y);
+    float pos_magni = fastHypot(errorPosition.x, errorPosition.y);
 
-    float acc_max_magni = -GRAVITY * cosf(neg_acc_angle) + sqrtf(powf(2*(airframe->maxThrust/airframe->mass), 2) - powf(GRAVITY * sinf(neg_acc_angle), 2));
+    float acc_sin, acc_cos;
+    fastSinCos(neg_acc_angle, &acc_sin, &acc_cos);
+    float acc_thrust = 2*(airframe->maxThrust/airframe->mass);
+    float acc_max_magni = -GRAVITY * acc_cos + fastSqrt(acc_thrust * acc_thrust - (GRAVITY * acc_sin) * (GRAVITY * acc_sin));
 
     float targetVelocityMagnitude = constDecelWithSoftStopToVelocity(pos_magni, 0.15*acc_max_magni, P_GAIN_POS_VEL);
 
 
-    targetVelocity.x = cos(pos_angle) * targetVelocityMagnitude;
-    targetVelocity.y = sin(pos_angle) * targetVelocityMagnitude;
+    float pos_sin, pos_cos;
+    fastSinCos(pos_angle, &pos_sin, &pos_cos);
+    targetVelocity.x = pos_cos * targetVelocityMagnitude;
+    targetVelocity.y = pos_sin * targetVelocityMagnitude;
 
 
     // targetVelocity.x = errorPosition.x * P_GAIN_POS_VEL;
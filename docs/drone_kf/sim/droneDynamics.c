@@ -2,18 +2,19 @@
 #include "droneDynamics.h"
 #include "integrator.h"
 #include <math.h>
+#include <stddef.h>
 
 void calc_accel(DRONE_T *pDrone, float leftCtrlInput, float rightCtrlInput)
 {
-    // get accelerations in bodyframe
-    float acc_b = (leftCtrlInput + rightCtrlInput) * pDrone->airframe.maxThrust / pDrone->airframe.mass;
+    DRONE_ACCEL_CTX_T ctx = {pDrone, leftCtrlInput, rightCtrlInput};
+    float q[INTEGRATOR_DIM] = {pDrone->states.pos.x, pDrone->states.pos.y, pDrone->states.angle};
+    float a[INTEGRATOR_DIM];
 
-    // tranlate to x y 
-    pDrone->states.accel.x = -sinf(pDrone->states.angle) * acc_b;
-    pDrone->states.accel.y =  cosf(pDrone->states.angle) * acc_b - GRAVITY;
+    droneAccel(a, q, NULL, &ctx);
 
-    // angular acceleration (b frame same as xy)
-    pDrone->states.angular_acc = (rightCtrlInput - leftCtrlInput) * pDrone->airframe.maxThrust * pDrone->airframe.propDist / pDrone->airframe.inertia;
+    pDrone->states.accel.x     = a[0];
+    pDrone->states.accel.y     = a[1];
+    pDrone->states.angular_acc = a[2];
 }
 
 void droneDynamicStep(DRONE_T *pDrone, float leftCtrlInput, float rightCtrlInput)
@@ -21,19 +22,27 @@ void droneDynamicStep(DRONE_T *pDrone, float leftCtrlInput, float rightCtrlInput
     // use effectors to calc accelerations
     calc_accel(pDrone, leftCtrlInput, rightCtrlInput);
 
-
-    // integrate positions / attitude
-    pDrone->states.angle = pDrone->states.angle + pDrone->states.angular_vel * pDrone->dt + 0.5 * pDrone->states.angular_acc * pDrone->dt * pDrone->dt;
-    pDrone->states.pos.x = pDrone->states.pos.x + pDrone->states.vel.x       * pDrone->dt + 0.5 * pDrone->states.accel.x     * pDrone->dt * pDrone->dt;
-    pDrone->states.pos.y = pDrone->states.pos.y + pDrone->states.vel.y       * pDrone->dt + 0.5 * pDrone->states.accel.y     * pDrone->dt * pDrone->dt;
-
-    //integrate accelerations into velocities
-    pDrone->states.angular_vel = euler_integrate(pDrone->states.angular_vel, pDrone->states.angular_acc, pDrone->dt);
-    pDrone->states.vel.x       = euler_integrate(pDrone->states.vel.x, pDrone->states.accel.x, pDrone->dt);
-    pDrone->states.vel.y       = euler_integrate(pDrone->states.vel.y, pDrone->states.accel.y, pDrone->dt);
-
-    // // integrate velocities into positions / attitude
-    // pDrone->states.angle = euler_integrate(pDrone->states.angle, pDrone->states.angular_vel, pDrone->dt);
-    // pDrone->states.pos.x = euler_integrate(pDrone->states.pos.x, pDrone->states.vel.x, pDrone->dt);
-    // pDrone->states.pos.y = euler_integrate(pDrone->states.pos.y, pDrone->states.vel.y, pDrone->dt);
-}
\ No newline at end of file
+    DRONE_ACCEL_CTX_T ctx = {pDrone, leftCtrlInput, rightCtrlInput};
+    INTEGRATOR_STATE_T s;
+    float a0[INTEGRATOR_DIM];
+
+    s.q[0] = pDrone->states.pos.x;
+    s.q[1] = pDrone->states.pos.y;
+    s.q[2] = pDrone->states.angle;
+    s.v[0] = pDrone->states.vel.x;
+    s.v[1] = pDrone->states.vel.y;
+    s.v[2] = pDrone->states.angular_vel;
+    a0[0] = pDrone->states.accel.x;
+    a0[1] = pDrone->states.accel.y;
+    a0[2] = pDrone->states.angular_acc;
+
+    // scheme chosen at compile time with SIM_INTEGRATOR, see integrator.h
+    integratorStep(&s, a0, droneAccel, &ctx, pDrone->dt);
+
+    pDrone->states.pos.x       = s.q[0];
+    pDrone->states.pos.y       = s.q[1];
+    pDrone->states.angle       = s.q[2];
+    pDrone->states.vel.x       = s.v[0];
+    pDrone->states.vel.y       = s.v[1];
+    pDrone->states.angular_vel = s.v[2];
+}
@@ -2,6 +2,35 @@
 #define DRONE_DYNAMICS_H
 
 #include "drone.h"
+#include <math.h>
+#include "fastMath.h"
+
+// controls held over one step, context of droneAccel
+typedef struct{
+    DRONE_T* drone;
+    float left;
+    float right;
+} DRONE_ACCEL_CTX_T;
+
+// integrator callback, q = (x, y, angle), a = (accel x, accel y, angular acc)
+static inline void droneAccel(float* a, float* q, float* v, void* ctx)
+{
+    DRONE_ACCEL_CTX_T* c = (DRONE_ACCEL_CTX_T*)ctx;
+    DRONE_AIRFRAME_T* airframe = &(c->drone->airframe);
+    (void)v;
+
+    // get accelerations in bodyframe
+    float acc_b = (c->left + c->right) * airframe->maxThrust / airframe->mass;
+
+    // tranlate to x y 
+    float sinAngle, cosAngle;
+    fastSinCos(q[2], &sinAngle, &cosAngle);
+    a[0] = -sinAngle * acc_b;
+    a[1] =  cosAngle * acc_b - GRAVITY;
+
+    // angular acceleration (b frame same as xy)
+    a[2] = (c->right - c->left) * airframe->maxThrust * airframe->propDist / airframe->inertia;
+}
 
 
 void calc_accel(DRONE_T* , float , float );
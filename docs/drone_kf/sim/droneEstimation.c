@@ -1,11 +1,25 @@
 #include "droneEstimation.h"
 #include "math.h"
+#include "fastMath.h"
 #include "kalman.h"
 #include "linalg.h"
 #include <stdio.h>
 #include "droneSensors.h"
 
 
+void setupEstimation(DRONE_T* drone)
+{
+    kalmanCreate(&(drone->estimation.kalman), drone->dt);
+
+    // late GNSS is fused at its sample step, filter and sensor clocks both start here
+    kalmanEnableHistory(&(drone->estimation.kalman));
+
+#ifdef SIM_KALMAN_SQRT
+    // square root filter, keeps P positive definite in float with sparse GNSS
+    kalmanSetMode(&(drone->estimation.kalman), KALMAN_MODE_SQRT);
+#endif
+}
+
 void attitudeComplementaryFilter(DRONE_T* drone)
 {
 
@@ -17,40 +31,65 @@ void attitudeComplementaryFilter(DRONE_T* drone)
 
     //accelerometer part
     float accelerometerAngleEstimate;
-    accelerometerAngleEstimate = atan2f(drone->sensors.accelerometer.x, drone->sensors.accelerometer.y);
+    accelerometerAngleEstimate = fastAtan2(drone->sensors.accelerometer.x, drone->sensors.accelerometer.y);
 
     //combine both parts
     drone->estimation.angle = biasToGyro * gyroAngleEstimate + (1-biasToGyro) * accelerometerAngleEstimate;
 }
 
-void pos_vel_estimate(DRONE_T* drone, int flag)
+// zMask holds the KALMAN_Z_* GNSS components that arrived this step,
+// 0 runs a prediction only step
+void pos_vel_estimate(DRONE_T* drone, unsigned char zMask)
 {
+    KALMAN_T* kf = &(drone->estimation.kalman);
+
+    // follows the sim step size, a no op while it stays the same
+    kalmanSetDt(kf, drone->dt);
 
-    MATRIX_T uInput; uInput.rows = 2; uInput.cols = 1;
-    matSet(&uInput, drone->sensors.accelerometer.x, 0, 0);
-    matSet(&uInput, drone->sensors.accelerometer.y, 1, 0);
-    kalman_u_InputStep(&uInput, drone->estimation.angle);
+    MAT2X1_T uInput;
+    mat2x1Set(&uInput, drone->sensors.accelerometer.x, 0, 0);
+    mat2x1Set(&uInput, drone->sensors.accelerometer.y, 1, 0);
+    kalman_u_InputStep(kf, &uInput, drone->estimation.angle);
 
 
-    if(flag)
+    if(zMask)
     {
-        MATRIX_T zInput; zInput.rows = 4; zInput.cols = 1;
-        matSet(&zInput, drone->sensors.GNSS_pos.x, 0, 0);
-        matSet(&zInput, drone->sensors.GNSS_pos.y, 1, 0);
-        matSet(&zInput, drone->sensors.GNSS_vel.x, 2, 0);
-        matSet(&zInput, drone->sensors.GNSS_vel.y, 3, 0);
-
-        kalman_z_InputStep(&zInput);
-        kalmanStep();
+        MAT4X1_T zInput;
+        mat4x1Set(&zInput, drone->sensors.GNSS_pos.x, 0, 0);
+        mat4x1Set(&zInput, drone->sensors.GNSS_pos.y, 1, 0);
+        mat4x1Set(&zInput, drone->sensors.GNSS_vel.x, 2, 0);
+        mat4x1Set(&zInput, drone->sensors.GNSS_vel.y, 3, 0);
+
+        kalman_z_InputStepMasked(kf, &zInput, zMask);
+        kalmanStep(kf);
     }
     else
     {
-        kalmanStep_predictionOnly();
+        kalmanStep_predictionOnly(kf);
     }
 
+    // late GNSS, samples of the same step are fused together
+    for(int iter = 0; iter < drone->sensors.delayedCount; )
+    {
+        MAT4X1_T zDelayed = mat4x1Zeros();
+        unsigned char maskDelayed = 0;
+        unsigned int stamp = drone->sensors.delayed[iter].stamp;
+
+        for(; iter < drone->sensors.delayedCount && drone->sensors.delayed[iter].stamp == stamp; iter++)
+        {
+            MEASUREMENT_T* m = &(drone->sensors.delayed[iter]);
+            int offset = (m->sensor == SENSOR_GNSS_POS) ? 0 : 2;
 
+            mat4x1Set(&zDelayed, m->value[0], offset, 0);
+            mat4x1Set(&zDelayed, m->value[1], offset + 1, 0);
+            maskDelayed |= (m->sensor == SENSOR_GNSS_POS) ? KALMAN_Z_POS : KALMAN_Z_VEL;
+        }
+
+        // older than the filter history, dropped
+        kalmanStepDelayed(kf, &zDelayed, maskDelayed, stamp);
+    }
 
-    MATRIX_T state = kalmanGetState();
+    MAT5X1_T state = kalmanGetState(kf);
     drone->estimation.pos.x = state.arr[0];
     drone->estimation.pos.y = state.arr[1];
     drone->estimation.vel.x = state.arr[2];
@@ -3,7 +3,8 @@
 
 #include "drone.h"
 
+void setupEstimation(DRONE_T* );
 void attitudeComplementaryFilter(DRONE_T* );
-void pos_vel_estimate(DRONE_T* , int);
+void pos_vel_estimate(DRONE_T* , unsigned char );
 
 #endif
\ No newline at end of file
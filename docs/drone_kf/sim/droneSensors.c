@@ -1,57 +1,190 @@
 #include <math.h>
 #include "droneSensors.h"
-#include "nrnd.h"
+#include "rng.h"
+#include "fastMath.h"
 
-void accelerometerMeasurement(DRONE_T* drone)
+void setupSensors(DRONE_T* drone)
+{
+    DRONE_SENSORS_T* sensors = &(drone->sensors);
+
+    sensorRateSet(&(sensors->rate[SENSOR_ACCELEROMETER]), ACCELEROMETER_RATE, ACCELEROMETER_LATENCY, drone->dt);
+    sensorRateSet(&(sensors->rate[SENSOR_GYROSCOPE]),     GYROSCOPE_RATE,     GYROSCOPE_LATENCY,     drone->dt);
+    sensorRateSet(&(sensors->rate[SENSOR_GNSS_POS]),      GNSS_RATE,          GNSS_LATENCY,          drone->dt);
+    sensorRateSet(&(sensors->rate[SENSOR_GNSS_VEL]),      GNSS_RATE,          GNSS_LATENCY,          drone->dt);
+
+    measurementQueueInit(&(sensors->queue));
+    sensors->delayedCount = 0;
+    sensors->step = 0;
+
+    rngStreamInit(&(sensors->noise), drone->seed, drone->id);
+    for(int sensor = 0; sensor < SENSOR_COUNT; sensor++)
+    {
+        rngNoiseReset(&(sensors->noiseBuffer[sensor]));
+    }
+}
+
+// noise stage, refills the buffers that ran out for the next RNG_NOISE_BLOCK
+// samples of their sensor in one pass, so the sensor models only read
+static void sensorNoiseStage(DRONE_SENSORS_T* sensors)
+{
+    for(int sensor = 0; sensor < SENSOR_COUNT; sensor++)
+    {
+        SENSOR_RATE_T* rate = &(sensors->rate[sensor]);
+        RNG_NOISE_BUFFER_T* buffer = &(sensors->noiseBuffer[sensor]);
+
+        if(rate->period && rngNoiseEmpty(buffer))
+        {
+            rngNoiseFill(buffer, &(sensors->noise), sensor, rate->next, rate->period);
+        }
+    }
+}
+
+// two standard normals for this sensor at the current sensor step
+static void sensorNoise(DRONE_T* drone, int sensor, float* z)
+{
+    DRONE_SENSORS_T* sensors = &(drone->sensors);
+    float* pair = rngNoiseNext(&(sensors->noiseBuffer[sensor]), &(sensors->noise), sensor, sensors->step);
+
+    z[0] = pair[0];
+    z[1] = pair[1];
+}
+
+static MEASUREMENT_T sampleSensor(DRONE_T* drone, int sensor)
+{
+    MEASUREMENT_T m;
+    VEC2D_T v = {0, 0};
+
+    switch(sensor)
+    {
+        case SENSOR_ACCELEROMETER: v = accelerometerMeasurement(drone); break;
+        case SENSOR_GYROSCOPE:     v.x = gyroscopeMeasurement(drone); break;
+        case SENSOR_GNSS_POS:      v = GNSSMeasurement_position(drone); break;
+        case SENSOR_GNSS_VEL:      v = GNSSMeasurement_velocity(drone); break;
+    }
+
+    m.stamp = drone->sensors.step;
+    m.arrival = m.stamp + drone->sensors.rate[sensor].latency;
+    m.sensor = sensor;
+    m.value[0] = v.x;
+    m.value[1] = v.y;
+    return m;
+}
+
+// advances the sensor clock one step: samples every sensor that is due,
+// queues the samples and moves the ones that have arrived into drone->sensors.
+// returns the KALMAN_Z_* components sampled and arrived this step, 0 if none.
+// GNSS that arrives late is left in sensors->delayed for the estimator
+unsigned char droneSensorsStep(DRONE_T* drone)
+{
+    DRONE_SENSORS_T* sensors = &(drone->sensors);
+    unsigned char zMask = 0;
+    MEASUREMENT_T m;
+
+    sensors->step++;
+    sensors->delayedCount = 0;
+
+    sensorNoiseStage(sensors);
+
+    for(int sensor = 0; sensor < SENSOR_COUNT; sensor++)
+    {
+        if(sensorRateDue(&(sensors->rate[sensor]), sensors->step))
+        {
+            m = sampleSensor(drone, sensor);
+            measurementQueuePush(&(sensors->queue), &m);
+        }
+    }
+
+    while(measurementQueuePop(&(sensors->queue), sensors->step, &m))
+    {
+        switch(m.sensor)
+        {
+            case SENSOR_ACCELEROMETER:
+                sensors->accelerometer.x = m.value[0];
+                sensors->accelerometer.y = m.value[1];
+                break;
+            case SENSOR_GYROSCOPE:
+                sensors->gyroscope = m.value[0];
+                break;
+            case SENSOR_GNSS_POS:
+                sensors->GNSS_pos.x = m.value[0];
+                sensors->GNSS_pos.y = m.value[1];
+                if(m.stamp == sensors->step){zMask |= KALMAN_Z_POS;}
+                break;
+            case SENSOR_GNSS_VEL:
+                sensors->GNSS_vel.x = m.value[0];
+                sensors->GNSS_vel.y = m.value[1];
+                if(m.stamp == sensors->step){zMask |= KALMAN_Z_VEL;}
+                break;
+        }
+
+        if((m.sensor == SENSOR_GNSS_POS || m.sensor == SENSOR_GNSS_VEL) && m.stamp != sensors->step)
+        {
+            sensors->delayed[sensors->delayedCount++] = m;
+        }
+    }
+
+    return zMask;
+}
+
+VEC2D_T accelerometerMeasurement(DRONE_T* drone)
 {
     VEC2D_T acc;
 
-    acc.x = sinf(drone->states.angle)*(drone->states.accel.y + GRAVITY) + cosf(drone->states.angle)*drone->states.accel.x;
-    acc.y = cosf(drone->states.angle)*(drone->states.accel.y + GRAVITY) - sinf(drone->states.angle)*drone->states.accel.x;
+    float s, c;
+    fastSinCos(drone->states.angle, &s, &c);
+
+    acc.x = s*(drone->states.accel.y + GRAVITY) + c*drone->states.accel.x;
+    acc.y = c*(drone->states.accel.y + GRAVITY) - s*drone->states.accel.x;
 
     //ADD NOIS E HERE
+    float z[2];
+    sensorNoise(drone, SENSOR_ACCELEROMETER, z);
 
-    acc.x += nrnd(0, 0.014);
-    acc.x += nrnd(0, 0.014);
+    acc.x += 0.014 * z[0];
+    acc.x += 0.014 * z[1];
 
 
-    //write to drone
-    drone->sensors.accelerometer = acc;
-   
+    return acc;
 }
 
-void gyroscopeMeasurement(DRONE_T* drone)
+float gyroscopeMeasurement(DRONE_T* drone)
 {
     float angularVelocity;
     angularVelocity = drone->states.angular_vel;
 
     // NOISE HERE 
-    angularVelocity += nrnd(0, 0.0038);
+    float z[2];
+    sensorNoise(drone, SENSOR_GYROSCOPE, z);
+    angularVelocity += 0.0038 * z[0];
     
-    drone->sensors.gyroscope = angularVelocity;
+    return angularVelocity;
 }
 
-void GNSSMeasurement_position(DRONE_T* drone)
+VEC2D_T GNSSMeasurement_position(DRONE_T* drone)
 {
     VEC2D_T GNSS_pos;
     GNSS_pos = drone->states.pos;
 
     //NOISE HERE
-    GNSS_pos.x += nrnd(0,0.05 * 3.3);
-    GNSS_pos.y += nrnd(0,0.05 * 5.3);
+    float z[2];
+    sensorNoise(drone, SENSOR_GNSS_POS, z);
+    GNSS_pos.x += 0.05 * 3.3 * z[0];
+    GNSS_pos.y += 0.05 * 5.3 * z[1];
 
-    drone->sensors.GNSS_pos = GNSS_pos;
+    return GNSS_pos;
 }
 
-void GNSSMeasurement_velocity(DRONE_T* drone)
+VEC2D_T GNSSMeasurement_velocity(DRONE_T* drone)
 {
     VEC2D_T GNSS_vel;
     GNSS_vel = drone->states.vel;
 
     //NOISE HERE
-    GNSS_vel.x += nrnd(0, 0.05 * 0.2);
-    GNSS_vel.y += nrnd(0, 0.05 * 0.2);
+    float z[2];
+    sensorNoise(drone, SENSOR_GNSS_VEL, z);
+    GNSS_vel.x += 0.05 * 0.2 * z[0];
+    GNSS_vel.y += 0.05 * 0.2 * z[1];
 
  
-    drone->sensors.GNSS_vel = GNSS_vel;
+    return GNSS_vel;
 }
\ No newline at end of file
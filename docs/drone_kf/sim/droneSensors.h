@@ -3,9 +3,20 @@
 
 #include "drone.h"
 
-void accelerometerMeasurement(DRONE_T* );
-void gyroscopeMeasurement(DRONE_T* );
-void GNSSMeasurement_position(DRONE_T* );
-void GNSSMeasurement_velocity(DRONE_T* );
+// sample rates (Hz) and latencies (s), rounded to whole sim steps
+#define ACCELEROMETER_RATE    100.0f
+#define ACCELEROMETER_LATENCY 0.0f
+#define GYROSCOPE_RATE        100.0f
+#define GYROSCOPE_LATENCY     0.0f
+#define GNSS_RATE             (100.0f / 11.0f) // every 11th step at dt = 0.01
+#define GNSS_LATENCY          0.0f
+
+void    setupSensors(DRONE_T* );
+unsigned char droneSensorsStep(DRONE_T* );
+
+VEC2D_T accelerometerMeasurement(DRONE_T* );
+float   gyroscopeMeasurement(DRONE_T* );
+VEC2D_T GNSSMeasurement_position(DRONE_T* );
+VEC2D_T GNSSMeasurement_velocity(DRONE_T* );
 
 #endif
@@ -0,0 +1,213 @@
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "linalgSimd.h"
+
+// trig for the step functions. one sincos per angle instead of separate
+// sinf/cosf calls, polynomial atan2, and sqrt helpers. define SIM_LIBM_MATH
+// to route everything back to libm.
+//
+// maximum error against double precision, |x| < 1e4 for sincos:
+//   fastSinCos  1.0e-7 absolute
+//   fastAtan2   2.0e-6 rad
+//   fastLog     1.0e-7 relative, x normal and positive
+//   fastSqrt    exact, sqrtf is a single instruction (f32.sqrt / sqrtss)
+//
+// droneMathAccuracy in droneBench.c measures the first two, drone_sim -bench
+// fails if they exceed these
+#define FAST_MATH_SINCOS_ERROR 1.0e-7f
+#define FAST_MATH_ATAN2_ERROR  2.0e-6f
+//
+// the SIMD variant fastSinCos4 runs the same operations in the same order as
+// fastSinCos, so both give identical results (droneBatch relies on that).
+
+// cody waite split of pi/2
+#define FAST_MATH_PIO2_1 1.5703125f
+#define FAST_MATH_PIO2_2 4.837512969970703125e-4f
+#define FAST_MATH_PIO2_3 7.54978995489188216e-8f
+#define FAST_MATH_2OPI   0.636619772367581343f
+#define FAST_MATH_PIO2   1.57079632679489662f
+#define FAST_MATH_PI     3.14159265358979324f
+#define FAST_MATH_ROUND  12582912.0f // 1.5 * 2^23, (x + R) - R rounds to nearest
+
+// minimax polynomials on [-pi/4, pi/4], z = r^2
+#define FAST_MATH_S1 -1.6666654611e-1f
+#define FAST_MATH_S2  8.3321608736e-3f
+#define FAST_MATH_S3 -1.9515295891e-4f
+#define FAST_MATH_C1  4.166664568298827e-2f
+#define FAST_MATH_C2 -1.388731625493765e-3f
+#define FAST_MATH_C3  2.443315711809948e-5f
+
+#ifndef SIM_LIBM_MATH
+
+static inline void fastSinCos(float x, float* s, float* c)
+{
+    // x = j * pi/2 + r with |r| <= pi/4
+    float j = (x * FAST_MATH_2OPI + FAST_MATH_ROUND) - FAST_MATH_ROUND;
+    float r = ((x - j * FAST_MATH_PIO2_1) - j * FAST_MATH_PIO2_2) - j * FAST_MATH_PIO2_3;
+    float z = r * r;
+
+    float sr = r + r * z * (FAST_MATH_S1 + z * (FAST_MATH_S2 + z * FAST_MATH_S3));
+    float cr = (1.0f - 0.5f * z) + z * z * (FAST_MATH_C1 + z * (FAST_MATH_C2 + z * FAST_MATH_C3));
+
+    switch((int)j & 3)
+    {
+        case 0:  *s =  sr; *c =  cr; break;
+        case 1:  *s =  cr; *c = -sr; break;
+        case 2:  *s = -sr; *c = -cr; break;
+        default: *s = -cr; *c =  sr; break;
+    }
+}
+
+static inline float fastAtan2(float y, float x)
+{
+    float ax = fabsf(x);
+    float ay = fabsf(y);
+    float hi = (ax > ay) ? ax : ay;
+    float lo = (ax > ay) ? ay : ax;
+
+    if(hi == 0)
+    {
+        return 0;
+    }
+
+    // atan on [0, 1]
+    float a = lo / hi;
+    float s = a * a;
+    float r = a * (0.99997726f + s * (-0.33262347f + s * (0.19354346f + s * (-0.11643287f + s * (0.05265332f + s * -0.01172120f)))));
+
+    if(ay > ax){r = FAST_MATH_PIO2 - r;}
+    if(x < 0){r = FAST_MATH_PI - r;}
+    return (y < 0) ? -r : r;
+}
+
+// log(x) = e * ln2 + log(m), m in [sqrt(1/2), sqrt(2)), cephes polynomial.
+// no checks for 0, negative, denormal or inf input
+static inline float fastLog(float x)
+{
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+
+    float e = (float)((int)(bits >> 23) - 126);
+    bits = (bits & 0x007FFFFFu) | 0x3F000000u; // mantissa in [0.5, 1)
+    float m;
+    memcpy(&m, &bits, sizeof(m));
+
+    if(m < 0.707106781186547524f)
+    {
+        e -= 1.0f;
+        m = m + m - 1.0f;
+    }
+    else
+    {
+        m = m - 1.0f;
+    }
+
+    float z = m * m;
+    float y = 7.0376836292e-2f;
+    y = y * m - 1.1514610310e-1f;
+    y = y * m + 1.1676998740e-1f;
+    y = y * m - 1.2420140846e-1f;
+    y = y * m + 1.4249322787e-1f;
+    y = y * m - 1.6668057665e-1f;
+    y = y * m + 2.0000714765e-1f;
+    y = y * m - 2.4999993993e-1f;
+    y = y * m + 3.3333331174e-1f;
+    y = y * m * z;
+
+    y += -2.12194440e-4f * e;
+    y += -0.5f * z;
+    return (m + y) + 0.693359375f * e;
+}
+
+#else
+
+static inline void fastSinCos(float x, float* s, float* c)
+{
+    *s = sinf(x);
+    *c = cosf(x);
+}
+
+static inline float fastAtan2(float y, float x)
+{
+    return atan2f(y, x);
+}
+
+static inline float fastLog(float x)
+{
+    return logf(x);
+}
+
+#endif
+
+static inline float fastSqrt(float x)
+{
+    return sqrtf(x);
+}
+
+// sqrt(x^2 + y^2) without the overflow care of hypotf
+static inline float fastHypot(float x, float y)
+{
+    return sqrtf(x * x + y * y);
+}
+
+
+#if LINALG_SIMD && !defined(SIM_LIBM_MATH)
+
+// 4 angles at once. the quadrant select is done arithmetically:
+// b0 = j mod 2 and b1 = (j / 2) mod 2 as 0 / 1 floats
+static inline void fastSinCos4(float* x, float* s, float* c)
+{
+    SIMD4_T round = simd4Splat(FAST_MATH_ROUND);
+    SIMD4_T one = simd4Splat(1.0f);
+    SIMD4_T two = simd4Splat(2.0f);
+    SIMD4_T half = simd4Splat(0.5f);
+    SIMD4_T quarter = simd4Splat(0.25f);
+
+    SIMD4_T xv = simd4Load(x);
+    SIMD4_T j = simd4Sub(simd4Add(simd4Mul(xv, simd4Splat(FAST_MATH_2OPI)), round), round);
+    SIMD4_T r = simd4Sub(simd4Sub(simd4Sub(xv, simd4Mul(j, simd4Splat(FAST_MATH_PIO2_1))), simd4Mul(j, simd4Splat(FAST_MATH_PIO2_2))), simd4Mul(j, simd4Splat(FAST_MATH_PIO2_3)));
+    SIMD4_T z = simd4Mul(r, r);
+
+    SIMD4_T ps = simd4Add(simd4Splat(FAST_MATH_S2), simd4Mul(z, simd4Splat(FAST_MATH_S3)));
+    ps = simd4Add(simd4Splat(FAST_MATH_S1), simd4Mul(z, ps));
+    SIMD4_T sr = simd4Add(r, simd4Mul(simd4Mul(r, z), ps));
+
+    SIMD4_T pc = simd4Add(simd4Splat(FAST_MATH_C2), simd4Mul(z, simd4Splat(FAST_MATH_C3)));
+    pc = simd4Add(simd4Splat(FAST_MATH_C1), simd4Mul(z, pc));
+    SIMD4_T cr = simd4Add(simd4Sub(one, simd4Mul(half, z)), simd4Mul(simd4Mul(z, z), pc));
+
+    // floor(h) for h in Z / 2 is round(h - 1/4)
+    SIMD4_T m = simd4Sub(simd4Add(simd4Sub(simd4Mul(j, half), quarter), round), round);
+    SIMD4_T b0 = simd4Sub(j, simd4Mul(two, m));
+    SIMD4_T m2 = simd4Sub(simd4Add(simd4Sub(simd4Mul(m, half), quarter), round), round);
+    SIMD4_T b1 = simd4Sub(m, simd4Mul(two, m2));
+
+    // quadrant 0..3: sin = s, c, -s, -c   cos = c, -s, -c, s
+    // b0 swaps s and c (negating s), b1 negates both
+    SIMD4_T nb0 = simd4Sub(one, b0);
+    SIMD4_T sign = simd4Sub(one, simd4Mul(two, b1));
+
+    SIMD4_T sv = simd4Add(simd4Mul(nb0, sr), simd4Mul(b0, cr));
+    SIMD4_T cv = simd4Sub(simd4Mul(nb0, cr), simd4Mul(b0, sr));
+
+    simd4Store(s, simd4Mul(sign, sv));
+    simd4Store(c, simd4Mul(sign, cv));
+}
+
+#else
+
+static inline void fastSinCos4(float* x, float* s, float* c)
+{
+    for(int iter = 0; iter < 4; iter++)
+    {
+        fastSinCos(x[iter], &s[iter], &c[iter]);
+    }
+}
+
+#endif
+
+#endif
@@ -1,6 +1,127 @@
 #ifndef INTEGRATOR_H
 #define INTEGRATOR_H
 
+// integrators for second order systems q'' = a(q, q'), the acceleration is
+// evaluated by a callback. every scheme is a static inline function and the
+// callback is passed as a known static function, so the compiler inlines the
+// whole step and there is no indirection per step. SIM_INTEGRATOR picks the
+// scheme integratorStep maps to, the others stay callable (see droneBench.c).
+
+#define INTEGRATOR_CONST_ACCEL   0 // position with constant acceleration, velocity euler
+#define INTEGRATOR_SEMI_IMPLICIT 1 // symplectic euler, velocity first
+#define INTEGRATOR_VERLET        2 // velocity verlet
+#define INTEGRATOR_RK4           3 // classic 4th order runge kutta
+
+#ifndef SIM_INTEGRATOR
+#define SIM_INTEGRATOR INTEGRATOR_CONST_ACCEL
+#endif
+
+#define INTEGRATOR_DIM 3 // x, y, angle
+
+typedef struct{
+    float q[INTEGRATOR_DIM]; // positions
+    float v[INTEGRATOR_DIM]; // velocities
+} INTEGRATOR_STATE_T;
+
+// a = acceleration at (q, v)
+typedef void (*INTEGRATOR_ACCEL_FN)(float* a, float* q, float* v, void* ctx);
+
 float euler_integrate(float , float , float );
 
-#endif
\ No newline at end of file
+
+// a0 is the acceleration at the start of the step, all schemes take it from
+// the caller so it is not evaluated twice
+
+static inline void integratorStepConstAccel(INTEGRATOR_STATE_T* s, float* a0, INTEGRATOR_ACCEL_FN accel, void* ctx, float dt)
+{
+    (void)accel; (void)ctx;
+    for(int iter = 0; iter < INTEGRATOR_DIM; iter++)
+    {
+        s->q[iter] = s->q[iter] + s->v[iter] * dt + 0.5 * a0[iter] * dt * dt;
+        s->v[iter] = euler_integrate(s->v[iter], a0[iter], dt);
+    }
+}
+
+static inline void integratorStepSemiImplicit(INTEGRATOR_STATE_T* s, float* a0, INTEGRATOR_ACCEL_FN accel, void* ctx, float dt)
+{
+    (void)accel; (void)ctx;
+    for(int iter = 0; iter < INTEGRATOR_DIM; iter++)
+    {
+        s->v[iter] = euler_integrate(s->v[iter], a0[iter], dt);
+        s->q[iter] = euler_integrate(s->q[iter], s->v[iter], dt);
+    }
+}
+
+// second order, one acceleration per step for accelerations that do not
+// depend on v (a(q, v) is evaluated with the half step velocity otherwise)
+static inline void integratorStepVerlet(INTEGRATOR_STATE_T* s, float* a0, INTEGRATOR_ACCEL_FN accel, void* ctx, float dt)
+{
+    float a1[INTEGRATOR_DIM];
+
+    for(int iter = 0; iter < INTEGRATOR_DIM; iter++)
+    {
+        s->v[iter] = s->v[iter] + 0.5f * a0[iter] * dt;
+        s->q[iter] = s->q[iter] + s->v[iter] * dt;
+    }
+
+    accel(a1, s->q, s->v, ctx);
+
+    for(int iter = 0; iter < INTEGRATOR_DIM; iter++)
+    {
+        s->v[iter] = s->v[iter] + 0.5f * a1[iter] * dt;
+    }
+}
+
+static inline void integratorStepRK4(INTEGRATOR_STATE_T* s, float* a0, INTEGRATOR_ACCEL_FN accel, void* ctx, float dt)
+{
+    float q[INTEGRATOR_DIM], v[INTEGRATOR_DIM];
+    float a2[INTEGRATOR_DIM], a3[INTEGRATOR_DIM], a4[INTEGRATOR_DIM];
+    float v2[INTEGRATOR_DIM], v3[INTEGRATOR_DIM], v4[INTEGRATOR_DIM];
+    float h = 0.5f * dt;
+
+    // k1 = (v, a0)
+    for(int iter = 0; iter < INTEGRATOR_DIM; iter++)
+    {
+        q[iter] = s->q[iter] + h * s->v[iter];
+        v[iter] = s->v[iter] + h * a0[iter];
+        v2[iter] = v[iter];
+    }
+    accel(a2, q, v, ctx);
+
+    for(int iter = 0; iter < INTEGRATOR_DIM; iter++)
+    {
+        q[iter] = s->q[iter] + h * v2[iter];
+        v[iter] = s->v[iter] + h * a2[iter];
+        v3[iter] = v[iter];
+    }
+    accel(a3, q, v, ctx);
+
+    for(int iter = 0; iter < INTEGRATOR_DIM; iter++)
+    {
+        q[iter] = s->q[iter] + dt * v3[iter];
+        v[iter] = s->v[iter] + dt * a3[iter];
+        v4[iter] = v[iter];
+    }
+    accel(a4, q, v, ctx);
+
+    for(int iter = 0; iter < INTEGRATOR_DIM; iter++)
+    {
+        s->q[iter] += dt / 6.0f * (s->v[iter] + 2.0f * v2[iter] + 2.0f * v3[iter] + v4[iter]);
+        s->v[iter] += dt / 6.0f * (a0[iter] + 2.0f * a2[iter] + 2.0f * a3[iter] + a4[iter]);
+    }
+}
+
+
+#if SIM_INTEGRATOR == INTEGRATOR_CONST_ACCEL
+#define integratorStep integratorStepConstAccel
+#elif SIM_INTEGRATOR == INTEGRATOR_SEMI_IMPLICIT
+#define integratorStep integratorStepSemiImplicit
+#elif SIM_INTEGRATOR == INTEGRATOR_VERLET
+#define integratorStep integratorStepVerlet
+#elif SIM_INTEGRATOR == INTEGRATOR_RK4
+#define integratorStep integratorStepRK4
+#else
+#error "unknown SIM_INTEGRATOR"
+#endif
+
+#endif
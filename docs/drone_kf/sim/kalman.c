@@ -1,163 +1,1008 @@
 #include "kalman.h"
 #include <math.h>
-
-static MATRIX_T P_pred;  //state covariance prediction
-static MATRIX_T P_update; // state covariance update
-static MATRIX_T Q; // covariance process noise
-static MATRIX_T R; // covariance sensor noise
-static MATRIX_T H; // sensor mapping
-static MATRIX_T x_pred; //state prediction
-static MATRIX_T x_update; //state update
-static MATRIX_T y; //inovation
-static MATRIX_T F; //state transition
-static MATRIX_T B; //input effect
-static MATRIX_T u; //input
-static MATRIX_T z; //sensor
-static MATRIX_T S; //innovation covariance
-static MATRIX_T K; //kalman gain
-static MATRIX_T I; //identity matrix
-static MATRIX_T rotation_wb; 
+#include "fastMath.h"
 
 
+// closed form F, B, Q of the continuous model for a step of dt
+static void kalmanDiscretize(KALMAN_DISCRETE_T* model, float dt)
+{
+    model->dt = dt;
 
+    //setup F
+    model->F = mat5x5Eye();
+    mat5x5Set(&model->F, dt, 0, 2);
+    mat5x5Set(&model->F, dt, 1, 3);
+    mat5x5Set(&model->F, dt, 3, 4);
+    mat5x5Set(&model->F, 0.5*powf(dt,2), 1, 4);
 
+    //setup B
+    model->B = mat5x2Zeros();
+    mat5x2Set(&model->B, 0.5*powf(dt,2), 0, 0);
+    mat5x2Set(&model->B, 0.5*powf(dt,2), 1, 1);
+    mat5x2Set(&model->B, dt, 2, 0);
+    mat5x2Set(&model->B, dt, 3, 1);
 
+    //setup Q
+    model->Q = sym5Zeros();
+    sym5Set(&model->Q, powf(0.5*0.0014*powf(dt,2) + 0.001, 2), 0, 0);
+    sym5Set(&model->Q, powf(0.5*0.0014*powf(dt,2) + 0.001, 2), 1, 1);
+    sym5Set(&model->Q, powf(0.0014*dt             + 0.005, 2), 2, 2);
+    sym5Set(&model->Q, powf(0.0014*dt             + 0.005, 2), 3, 3);
+}
 
 //states for now: x, y, vx, vy, g
-void setupKalman(float dt)
+void kalmanCreate(KALMAN_T* kf, float dt)
 {
-    //setup F
-    F = matEye(5);
-    matSet(&F, dt, 0, 2);
-    matSet(&F, dt, 1, 3);
-    matSet(&F, dt, 3, 4);
-    matSet(&F, 0.5*powf(dt,2), 1, 4);
-
-    //setup B
-    B = matZeros(5, 2);
-    matSet(&B, 0.5*powf(dt,2), 0, 0);
-    matSet(&B, 0.5*powf(dt,2), 1, 1);
-    matSet(&B, dt, 2, 0);
-    matSet(&B, dt, 3, 1);
+    KALMAN_DISCRETE_T model;
+    kalmanDiscretize(&model, dt);
+    kf->dt = dt;
+    kf->F = model.F;
+    kf->B = model.B;
+    kf->Q = model.Q;
 
     //setup H
-    H = matZeros(4,5);
-    matSet(&H, 1, 0, 0);
-    matSet(&H, 1, 1, 1);
-    matSet(&H, 1, 2, 2);
-    matSet(&H, 1, 3, 3);
+    kf->H = mat4x5Zeros();
+    mat4x5Set(&kf->H, 1, 0, 0);
+    mat4x5Set(&kf->H, 1, 1, 1);
+    mat4x5Set(&kf->H, 1, 2, 2);
+    mat4x5Set(&kf->H, 1, 3, 3);
 
     //setup P_update
-    P_update = matZeros(5,5);
-    matSet(&P_update, powf(0.005,  2), 0, 0);
-    matSet(&P_update, powf(0.005,  2), 1, 1);
-    matSet(&P_update, powf(0.0005, 2), 2, 2);
-    matSet(&P_update, powf(0.0005, 2), 3, 3); 
-
-    //setup Q
-    Q = matZeros(5,5);
-    matSet(&Q, powf(0.5*0.0014*powf(dt,2) + 0.001, 2), 0, 0);
-    matSet(&Q, powf(0.5*0.0014*powf(dt,2) + 0.001, 2), 1, 1);
-    matSet(&Q, powf(0.0014*dt             + 0.005, 2), 2, 2);
-    matSet(&Q, powf(0.0014*dt             + 0.005, 2), 3, 3);
+    kf->P_update = sym5Zeros();
+    sym5Set(&kf->P_update, powf(0.005,  2), 0, 0);
+    sym5Set(&kf->P_update, powf(0.005,  2), 1, 1);
+    sym5Set(&kf->P_update, powf(0.0005, 2), 2, 2);
+    sym5Set(&kf->P_update, powf(0.0005, 2), 3, 3); 
 
     //setup R
-    R = matZeros(4,4);
-    matSet(&R, pow(0.05 * 3.3, 2), 0, 0);
-    matSet(&R, pow(0.05 * 5.3, 2), 1, 1);
-    matSet(&R, pow(0.05 * 0.2, 2), 2, 2);
-    matSet(&R, pow(0.05 * 0.2, 2), 3, 3);
+    kf->R = sym4Zeros();
+    sym4Set(&kf->R, pow(0.05 * 3.3, 2), 0, 0);
+    sym4Set(&kf->R, pow(0.05 * 5.3, 2), 1, 1);
+    sym4Set(&kf->R, pow(0.05 * 0.2, 2), 2, 2);
+    sym4Set(&kf->R, pow(0.05 * 0.2, 2), 3, 3);
 
     //setup x_update at t0
-    x_update = matZeros(5,1);
-    matSet(&x_update, -9.81, 4, 0);
+    kf->x_update = mat5x1Zeros();
+    mat5x1Set(&kf->x_update, -9.81, 4, 0);
 
     //setup I
-    I = matEye(5);
+    kf->I = mat5x5Eye();
 
     //setup u
-    u.rows = 2; u.cols = 1;
+    kf->u = mat2x1Zeros();
 
     //setup z
-    z.rows = 4; z.cols = 1;
+    kf->z = mat4x1Zeros();
 
     //setup rotation_wb
-    rotation_wb.rows = 2;
-    rotation_wb.cols = 2;
+    kf->rotation_wb = mat2x2Zeros();
+
+    kf->zMask = KALMAN_Z_ALL;
+    kf->mode = KALMAN_MODE_STANDARD;
+    kf->step = 0;
+    kf->preint.pending = 0;
+    kf->history.enabled = 0;
+    kf->history.count = 0;
+    kf->steady.enabled = 0;
+    kf->telemetry = NULL;
+    kf->scratch = NULL;
+    kalmanModelChanged(kf);
+}
+
+// back to the full filter, starting from the cached covariance of the current phase
+static void kalmanLeaveSteadyState(KALMAN_T* kf)
+{
+    if(kf->steady.enabled)
+    {
+        kf->P_update = kf->steady.P[kf->steady.phase];
+        kf->steady.enabled = 0;
+    }
+}
+
+// upper triangular U with A = U^T U for a symmetric positive semidefinite A.
+// a zero pivot (e.g. the gravity state, which has no noise) leaves a zero row
+// instead of failing like matdCholeskyInto
+static void kalmanSqrtFactor(MATRIXD_T* U, MATRIXD_T* A)
+{
+    int n = A->rows;
+
+    for(int row = 0; row < n; row++)
+    {
+        for(int col = 0; col < n; col++)
+        {
+            matdSet(U, 0, row, col);
+        }
+    }
+
+    for(int row = 0; row < n; row++)
+    {
+        float d = matdGet(A, row, row);
+        for(int iter = 0; iter < row; iter++)
+        {
+            d -= matdGet(U, iter, row) * matdGet(U, iter, row);
+        }
+        if(!(d > 0)){continue;}
+
+        d = sqrtf(d);
+        matdSet(U, d, row, row);
+
+        for(int col = row + 1; col < n; col++)
+        {
+            float u = matdGet(A, row, col);
+            for(int iter = 0; iter < row; iter++)
+            {
+                u -= matdGet(U, iter, row) * matdGet(U, iter, col);
+            }
+            matdSet(U, u / d, row, col);
+        }
+    }
+}
+
+static void kalmanSqrtFactorSym5(MAT5X5_T* U, SYM5_T* P)
+{
+    MAT5X5_T full;
+    sym5ToFullInto(&full, P);
+
+    MATRIXD_T Uv = {U->arr, 5, 5};
+    MATRIXD_T Pv = {full.arr, 5, 5};
+    kalmanSqrtFactor(&Uv, &Pv);
+}
+
+// P = S^T S for an upper triangular S
+static void kalmanCovarianceFromSqrt(SYM5_T* P, MAT5X5_T* S)
+{
+    for(int row = 0; row < 5; row++)
+    {
+        for(int col = row; col < 5; col++)
+        {
+            float sum = 0;
+            for(int iter = 0; iter <= row; iter++)
+            {
+                sum += mat5x5Get(S, iter, row) * mat5x5Get(S, iter, col);
+            }
+            sym5Set(P, sum, row, col);
+        }
+    }
+}
+
+// brings P_update up to x_update, call before reading P_update directly.
+// P_pred then equals P_update as after kalmanStep_predictionOnly
+void kalmanFlushPrediction(KALMAN_T* kf)
+{
+    if(kf->preint.pending == 0)
+    {
+        return;
+    }
+
+    int n = kf->preint.pending - 1;
+    kf->P_pred = kf->preint.Q_sum[n];
+    sym5Triple5x5AddInto(&kf->P_pred, &kf->preint.F_pow[n], &kf->P_update);
+    kf->P_update = kf->P_pred;
+    kf->preint.pending = 0;
+}
+
+// F^n and Q_n for the deferred covariance propagation
+static void kalmanPreintTables(KALMAN_T* kf)
+{
+    kf->preint.F_pow[0] = kf->F;
+    kf->preint.Q_sum[0] = kf->Q;
+
+    for(int iter = 1; iter < KALMAN_PREINT_MAX; iter++)
+    {
+        mat5x5Mul5x5Into(&kf->preint.F_pow[iter], &kf->F, &kf->preint.F_pow[iter - 1]);
+
+        kf->preint.Q_sum[iter] = kf->Q;
+        sym5Triple5x5AddInto(&kf->preint.Q_sum[iter], &kf->F, &kf->preint.Q_sum[iter - 1]);
+    }
+}
+
+// call after changing F, B, H, Q or R so the update path is chosen again
+void kalmanModelChanged(KALMAN_T* kf)
+{
+    // cached gains and tables belong to the old model, the steps
+    // already taken are finished on it
+    kalmanLeaveSteadyState(kf);
+    kalmanFlushPrediction(kf);
+    kalmanPreintTables(kf);
+    kf->preint.dt = kf->dt;
+
+    // a diagonal R means the measurement components are independent.
+    // KALMAN_NO_SEQUENTIAL keeps the dense update, make check compares the two
+#ifdef KALMAN_NO_SEQUENTIAL
+    kf->sequentialUpdate = 0;
+#else
+    kf->sequentialUpdate = 1;
+#endif
+    for(int row = 0; row < 4; row++)
+    {
+        for(int col = row + 1; col < 4; col++)
+        {
+            if(sym4Get(&kf->R, row, col) != 0){kf->sequentialUpdate = 0;}
+        }
+    }
+
+    kalmanSqrtFactorSym5(&kf->Q_sqrt, &kf->Q);
+
+    // the current matrices, edits included, are what this dt maps to from now on
+    KALMAN_DISCRETE_T* entry = &(kf->dtCache.entries[0]);
+    entry->dt = kf->dt;
+    entry->F = kf->F;
+    entry->B = kf->B;
+    entry->Q = kf->Q;
+    entry->Q_sqrt = kf->Q_sqrt;
+    kf->dtCache.count = 1;
+    kf->dtCache.next = 1 % KALMAN_DT_CACHE_LEN;
+}
+
+// step size of the following predictions. the discretized model of a dt that
+// was used recently comes from the cache, any other dt is built in closed form
+// (manual edits to F, B or Q only stick to the dt they were made at).
+// deferred covariance steps are finished first, and only steps at the dt of
+// the last kalmanModelChanged are deferred or run on the steady state gain
+void kalmanSetDt(KALMAN_T* kf, float dt)
+{
+    if(dt == kf->dt)
+    {
+        return;
+    }
+
+    kalmanLeaveSteadyState(kf);
+    kalmanFlushPrediction(kf);
+
+    KALMAN_DISCRETE_T* entry = NULL;
+    for(int iter = 0; iter < kf->dtCache.count; iter++)
+    {
+        if(kf->dtCache.entries[iter].dt == dt)
+        {
+            entry = &(kf->dtCache.entries[iter]);
+            break;
+        }
+    }
+
+    if(!entry)
+    {
+        // replaces the oldest entry once the cache is full
+        entry = &(kf->dtCache.entries[kf->dtCache.next]);
+        kalmanDiscretize(entry, dt);
+        kalmanSqrtFactorSym5(&entry->Q_sqrt, &entry->Q);
+
+        kf->dtCache.next = (kf->dtCache.next + 1) % KALMAN_DT_CACHE_LEN;
+        if(kf->dtCache.count < KALMAN_DT_CACHE_LEN){kf->dtCache.count++;}
+    }
+
+    kf->dt = dt;
+    kf->F = entry->F;
+    kf->B = entry->B;
+    kf->Q = entry->Q;
+    kf->Q_sqrt = entry->Q_sqrt;
+}
+
+// switches the estimator, the new mode starts from the current P_update
+void kalmanSetMode(KALMAN_T* kf, int mode)
+{
+    kalmanLeaveSteadyState(kf);
+    kalmanFlushPrediction(kf);
+
+    kf->mode = mode;
+    if(mode == KALMAN_MODE_SQRT)
+    {
+        kalmanSqrtFactorSym5(&kf->S_update, &kf->P_update);
+    }
+}
+
+void kalman_u_InputStep(KALMAN_T* kf, MAT2X1_T* uInput, float angle)
+{
+    float s, c;
+    fastSinCos(angle, &s, &c);
+
+    mat2x2Set(&kf->rotation_wb,  c, 0, 0);
+    mat2x2Set(&kf->rotation_wb, -s, 0, 1);
+    mat2x2Set(&kf->rotation_wb,  s, 1, 0);
+    mat2x2Set(&kf->rotation_wb,  c, 1, 1);
+    mat2x2Mul2x1Into(&kf->u, &kf->rotation_wb, uInput);
 }
 
-void kalman_u_InputStep(MATRIX_T* uInput, float angle)
+void kalman_z_InputStep(KALMAN_T* kf, MAT4X1_T* zInput)
 {
-    matSet(&rotation_wb,  cosf(angle), 0, 0);
-    matSet(&rotation_wb, -sinf(angle), 0, 1);
-    matSet(&rotation_wb,  sinf(angle), 1, 0);
-    matSet(&rotation_wb,  cosf(angle), 1, 1);
-    u = matMul(&rotation_wb, uInput);
+    kalman_z_InputStepMasked(kf, zInput, KALMAN_Z_ALL);
 }
 
-void kalman_z_InputStep(MATRIX_T* zInput)
+// only the components in mask are fused, e.g. KALMAN_Z_POS when only a position fix arrived
+void kalman_z_InputStepMasked(KALMAN_T* kf, MAT4X1_T* zInput, unsigned char mask)
 {
-    z = *zInput;
+    kf->z = *zInput;
+    kf->zMask = mask;
 }
 
+// x_pred = F x + B u
+static void kalmanPredictState(KALMAN_T* kf)
+{
+    mat5x5Mul5x1Into(&kf->x_pred, &kf->F, &kf->x_update);
+    mat5x2Mul2x1AddInto(&kf->x_pred, &kf->B, &kf->u);
+}
+
+// P_pred = F P F^T + Q, or the deferred steps plus this one from the tables.
+// the tables are built for preint.dt, a step at another dt finishes the
+// deferred ones first
+static void kalmanPredictCovariance(KALMAN_T* kf)
+{
+    if(kf->preint.pending > 0 && kf->dt != kf->preint.dt)
+    {
+        kalmanFlushPrediction(kf);
+    }
+
+    if(kf->preint.pending == 0)
+    {
+        kf->P_pred = kf->Q;
+        sym5Triple5x5AddInto(&kf->P_pred, &kf->F, &kf->P_update);
+        return;
+    }
+
+    int n = kf->preint.pending;
+    kf->P_pred = kf->preint.Q_sum[n];
+    sym5Triple5x5AddInto(&kf->P_pred, &kf->preint.F_pow[n], &kf->P_update);
+    kf->preint.pending = 0;
+}
+
+static void kalmanPredict(KALMAN_T* kf)
+{
+    kalmanPredictState(kf);
+    kalmanPredictCovariance(kf);
+}
+
+// components are fused one at a time as scalar updates, valid because R is
+// diagonal. each one only needs a division, no decomposition. P takes the
+// scalar joseph form (I - k h^T) P (I - k h^T)^T + r k k^T, which keeps it
+// symmetric positive semidefinite under roundoff like the dense path
+static void kalmanUpdateSequential(KALMAN_T* kf)
+{
+    kf->x_update = kf->x_pred;
+    kf->P_update = kf->P_pred;
+    kf->S = sym4Zeros();
+    kf->K = mat5x4Zeros();
+
+    for(int meas = 0; meas < 4; meas++)
+    {
+        kf->y.arr[meas] = 0;
+        if(!(kf->zMask & (1 << meas))){continue;}
+
+        float* h = &(kf->H.arr[meas * 5]);
+        float r = sym4Get(&kf->R, meas, meas);
+        float Ph[5];
+        float k[5];
+        float s = r;
+        float hx = 0;
+
+        for(int row = 0; row < 5; row++)
+        {
+            Ph[row] = 0;
+            for(int iter = 0; iter < 5; iter++)
+            {
+                Ph[row] += sym5Get(&kf->P_update, row, iter) * h[iter];
+            }
+            s  += h[row] * Ph[row];
+            hx += h[row] * kf->x_update.arr[row];
+        }
+
+        kf->y.arr[meas] = kf->z.arr[meas] - hx;
+        sym4Set(&kf->S, s, meas, meas);
+
+        for(int row = 0; row < 5; row++)
+        {
+            k[row] = Ph[row] / s;
+            mat5x4Set(&kf->K, k[row], row, meas);
+            kf->x_update.arr[row] += k[row] * kf->y.arr[meas];
+        }
+
+        // A = (I - k h^T) P, row by row, then A h for the right factor
+        float A[5][5];
+        float Ah[5];
+        for(int row = 0; row < 5; row++)
+        {
+            Ah[row] = 0;
+            for(int col = 0; col < 5; col++)
+            {
+                A[row][col] = sym5Get(&kf->P_update, row, col) - k[row] * Ph[col];
+                Ah[row] += A[row][col] * h[col];
+            }
+        }
+
+        // A (I - k h^T)^T + r k k^T, unique entries only
+        for(int row = 0; row < 5; row++)
+        {
+            for(int col = row; col < 5; col++)
+            {
+                sym5Set(&kf->P_update, A[row][col] - Ah[row] * k[col] + r * k[row] * k[col], row, col);
+            }
+        }
+    }
+}
+
+// covariance half of the dense update: S = H P H^T + R, K = P H^T S^-1 and
+// P_update in joseph form (I-KH) P (I-KH)^T + K R K^T, unique entries only
+static void kalmanDenseCovariance(KALMAN_T* kf, MAT4X5_T* H, SYM4_T* R, SYM5_T* P_pred, SYM5_T* P_update, MAT5X4_T* K, SYM4_T* S)
+{
+    MAT5X4_T PHT;
+    MAT5X5_T IKH;
+
+    sym5MulT4x5Into(&PHT, P_pred, H);
+    *S = *R;
+    sym5Triple4x5AddInto(S, H, P_pred);
+
+    // K * S = PHT, S is symmetric positive definite so LDL^T does it,
+    // QR only if rounding ever made it indefinite
+    if(sym4SolveRight5x4Into(K, S, &PHT))
+    {
+        MAT4X4_T S_full;
+        sym4ToFullInto(&S_full, S);
+        mat4x4SolveRight5x4Into(K, &S_full, &PHT);
+    }
+
+    mat5x4Mul4x5Into(&IKH, K, H);
+    mat5x5SubInto(&IKH, &kf->I, &IKH);
+    sym5Triple5x5Into(P_update, &IKH, P_pred);
+    sym4Triple5x4AddInto(P_update, K, R);
+}
+
+// full vector update for a correlated R. components missing from the mask get
+// a zero row in H and a unit decoupled entry in R, so their gain is exactly zero
+static void kalmanUpdateDense(KALMAN_T* kf)
+{
+    MAT4X5_T H = kf->H;
+    SYM4_T R = kf->R;
+
+    if(kf->zMask != KALMAN_Z_ALL)
+    {
+        for(int meas = 0; meas < 4; meas++)
+        {
+            if(kf->zMask & (1 << meas)){continue;}
+
+            for(int iter = 0; iter < 5; iter++){mat4x5Set(&H, 0, meas, iter);}
+            for(int iter = 0; iter < 4; iter++){sym4Set(&R, (iter == meas) ? 1 : 0, meas, iter);}
+        }
+    }
+
+    mat4x5Mul5x1Into(&kf->y, &H, &kf->x_pred);
+    mat4x1SubInto(&kf->y, &kf->z, &kf->y);
+    for(int meas = 0; meas < 4; meas++)
+    {
+        if(!(kf->zMask & (1 << meas))){kf->y.arr[meas] = 0;}
+    }
+
+    kalmanDenseCovariance(kf, &H, &R, &kf->P_pred, &kf->P_update, &kf->K, &kf->S);
+
+    kf->x_update = kf->x_pred;
+    mat5x4Mul4x1AddInto(&kf->x_update, &kf->K, &kf->y);
+}
+
+// square root time update. the R factor of the stacked pre array
+// [S F^T; Q_sqrt] is the factor of F P F^T + Q, so P_pred is never formed
+// and stays positive semidefinite by construction. returns 1 if the arena
+// is exhausted
+static int kalmanSqrtPredict(KALMAN_T* kf, ARENA_T* arena)
+{
+    kalmanPredictState(kf);
+
+    MATRIXD_T S = {kf->S_update.arr, 5, 5};
+    MATRIXD_T F = {kf->F.arr, 5, 5};
+    MATRIXD_T Qs = {kf->Q_sqrt.arr, 5, 5};
+
+    QRD_T qr;
+    qr.QR = matdAlloc(arena, 10, 5);
+    qr.tau = arenaAlloc(arena, sizeof(float) * 5);
+    if(!qr.QR.arr || !qr.tau)
+    {
+        return 1;
+    }
+
+    MATRIXD_T top = {qr.QR.arr, 5, 5};
+    MATRIXD_T bottom = {qr.QR.arr + 25, 5, 5};
+    matdMulTransBInto(&top, &S, &F);
+    matdCopyInto(&bottom, &Qs);
+
+    matdQRCompactInPlace(&qr);
+
+    for(int row = 0; row < 5; row++)
+    {
+        for(int col = 0; col < 5; col++)
+        {
+            mat5x5Set(&kf->S_pred, (col >= row) ? matdGet(&qr.QR, row, col) : 0, row, col);
+        }
+    }
+    kalmanCovarianceFromSqrt(&kf->P_pred, &kf->S_pred);
+    return 0;
+}
+
+// square root measurement update over the components in zMask. with m of
+// them the (m+5)x(m+5) pre array
+//   [ R_sqrt      0      ]      [ X  Y ]
+//   [ S H^T    S_pred    ]  QR  [ 0  Z ]
+// gives X^T X = H P H^T + R, Y = X^-T H P and Z^T Z = P - K H P, so
+// K^T = X^-1 Y and Z is the updated factor. returns 1 if the arena is exhausted
+static int kalmanSqrtUpdate(KALMAN_T* kf, ARENA_T* arena)
+{
+    int idx[4];
+    int m = 0;
+    for(int iter = 0; iter < 4; iter++)
+    {
+        if(kf->zMask & (1 << iter)){idx[m++] = iter;}
+    }
+
+    mat4x5Mul5x1Into(&kf->y, &kf->H, &kf->x_pred);
+    mat4x1SubInto(&kf->y, &kf->z, &kf->y);
+
+    kf->K = mat5x4Zeros();
+    kf->S = sym4Zeros();
+    for(int iter = 0; iter < 4; iter++)
+    {
+        if(!(kf->zMask & (1 << iter)))
+        {
+            kf->y.arr[iter] = 0;
+            sym4Set(&kf->S, 1, iter, iter);
+        }
+    }
+
+    if(m == 0)
+    {
+        kf->x_update = kf->x_pred;
+        kf->S_update = kf->S_pred;
+        return 0;
+    }
+
+    int n = m + 5;
+    MATRIXD_T R = matdAlloc(arena, m, m);
+    MATRIXD_T Rs = matdAlloc(arena, m, m);
+    QRD_T qr;
+    qr.QR = matdZeros(arena, n, n);
+    qr.tau = arenaAlloc(arena, sizeof(float) * n);
+    MATRIXD_T X = matdZeros(arena, m, m);
+    MATRIXD_T Y = matdAlloc(arena, m, 5);
+    MATRIXD_T Kt = matdAlloc(arena, m, 5);
+    if(!R.arr || !Rs.arr || !qr.QR.arr || !qr.tau || !X.arr || !Y.arr || !Kt.arr)
+    {
+        return 1;
+    }
+
+    for(int row = 0; row < m; row++)
+    {
+        for(int col = 0; col < m; col++)
+        {
+            matdSet(&R, sym4Get(&kf->R, idx[row], idx[col]), row, col);
+        }
+    }
+    kalmanSqrtFactor(&Rs, &R);
+
+    for(int row = 0; row < m; row++)
+    {
+        for(int col = row; col < m; col++)
+        {
+            matdSet(&qr.QR, matdGet(&Rs, row, col), row, col);
+        }
+    }
+    for(int row = 0; row < 5; row++)
+    {
+        for(int col = 0; col < m; col++)
+        {
+            float sum = 0;
+            for(int iter = row; iter < 5; iter++)
+            {
+                sum += mat5x5Get(&kf->S_pred, row, iter) * mat4x5Get(&kf->H, idx[col], iter);
+            }
+            matdSet(&qr.QR, sum, m + row, col);
+        }
+        for(int col = row; col < 5; col++)
+        {
+            matdSet(&qr.QR, mat5x5Get(&kf->S_pred, row, col), m + row, m + col);
+        }
+    }
+
+    matdQRCompactInPlace(&qr);
+
+    for(int row = 0; row < m; row++)
+    {
+        for(int col = row; col < m; col++)
+        {
+            matdSet(&X, matdGet(&qr.QR, row, col), row, col);
+        }
+        for(int col = 0; col < 5; col++)
+        {
+            matdSet(&Y, matdGet(&qr.QR, row, m + col), row, col);
+        }
+    }
+    matdRBSInto(&Kt, &X, &Y);
+
+    for(int row = 0; row < 5; row++)
+    {
+        for(int col = 0; col < 5; col++)
+        {
+            mat5x5Set(&kf->S_update, (col >= row) ? matdGet(&qr.QR, m + row, m + col) : 0, row, col);
+        }
+    }
+
+    // innovation covariance X^T X and gain for telemetry
+    for(int row = 0; row < m; row++)
+    {
+        for(int col = row; col < m; col++)
+        {
+            float sum = 0;
+            for(int iter = 0; iter <= row; iter++)
+            {
+                sum += matdGet(&X, iter, row) * matdGet(&X, iter, col);
+            }
+            sym4Set(&kf->S, sum, idx[row], idx[col]);
+        }
+        for(int col = 0; col < 5; col++)
+        {
+            mat5x4Set(&kf->K, matdGet(&Kt, row, col), col, idx[row]);
+        }
+    }
+
+    kf->x_update = kf->x_pred;
+    mat5x4Mul4x1AddInto(&kf->x_update, &kf->K, &kf->y);
+    return 0;
+}
 
-void kalmanStep()
+static void kalmanUpdate(KALMAN_T* kf)
 {
-    MATRIX_T Fx = matMul(&F, &x_update);
-    MATRIX_T Bu = matMul(&B, &u);
-    x_pred = matAdd(&Fx, &Bu);
+    if(kf->sequentialUpdate)
+    {
+        kalmanUpdateSequential(kf);
+    }
+    else
+    {
+        kalmanUpdateDense(kf);
+    }
+}
 
-    MATRIX_T FP = matMul(&F, &P_update);
-    MATRIX_T FT = matTranspose(&F);
-    MATRIX_T FPFT = matMul(&FP, &FT);
-    P_pred = matAdd(&FPFT, &Q);
+#if TELEMETRY_ENABLED
+static void kalmanRecordTelemetry(KALMAN_T* kf, MAT5X4_T* K)
+{
+    TELEMETRY_RECORD_T* record = telemetryPush(kf->telemetry);
+
+    for(int iter = 0; iter < 5; iter++)
+    {
+        record->x[iter] = kf->x_update.arr[iter];
+        record->Pdiag[iter] = sym5Get(&kf->P_update, iter, iter);
+    }
+    for(int iter = 0; iter < 4; iter++)
+    {
+        record->y[iter] = kf->y.arr[iter];
+    }
+
+    float sum = 0;
+    for(int iter = 0; iter < 20; iter++)
+    {
+        sum += K->arr[iter] * K->arr[iter];
+    }
+    record->gainNorm = sqrtf(sum);
+}
+#endif
 
-    MATRIX_T Hx = matMul(&H, &x_pred);
-    y = matSub(&z, &Hx);
+// one square root step, update 0 only predicts. the matrices come from
+// kf->scratch and are released afterwards, without it from
+// KALMAN_SQRT_SCRATCH_BYTES on the stack. if the scratch runs out the step
+// is taken in covariance form from P_update and factored again
+static void kalmanSqrtStep(KALMAN_T* kf, int update)
+{
+    unsigned char stackScratch[KALMAN_SQRT_SCRATCH_BYTES];
+    ARENA_T stackArena;
+    ARENA_T* arena = kf->scratch;
+    if(arena == NULL)
+    {
+        arenaInit(&stackArena, stackScratch, sizeof(stackScratch));
+        arena = &stackArena;
+    }
+
+    size_t mark = arenaMark(arena);
+    int failed = kalmanSqrtPredict(kf, arena);
+    if(!failed && update)
+    {
+        failed = kalmanSqrtUpdate(kf, arena);
+    }
+    arenaRelease(arena, mark);
+
+    if(failed)
+    {
+        kalmanPredict(kf);
+        kalmanSqrtFactorSym5(&kf->S_pred, &kf->P_pred);
+        if(update)
+        {
+            kalmanUpdate(kf);
+            kalmanSqrtFactorSym5(&kf->S_update, &kf->P_update);
+            return;
+        }
+    }
+    if(!update)
+    {
+        kf->x_update = kf->x_pred;
+        kf->S_update = kf->S_pred;
+    }
+    kalmanCovarianceFromSqrt(&kf->P_update, &kf->S_update);
+}
 
-    MATRIX_T HT = matTranspose(&H);
-    MATRIX_T PHT = matMul(&P_pred, &HT);
-    MATRIX_T HPHT = matMul(&H, &PHT);
-    S = matAdd(&HPHT, &R);
+// predict + update in the current mode
+static void kalmanFilterStep(KALMAN_T* kf)
+{
+    if(kf->mode == KALMAN_MODE_SQRT)
+    {
+        kalmanSqrtStep(kf, 1);
+        return;
+    }
+
+    // the cached gain only fits a full update at the expected point of the cycle
+    if(kf->steady.enabled && ((kf->steady.phase != kf->steady.period - 1) || (kf->zMask != KALMAN_Z_ALL)))
+    {
+        kalmanLeaveSteadyState(kf);
+    }
+
+    if(kf->steady.enabled)
+    {
+        kalmanPredictState(kf);
+
+        mat4x5Mul5x1Into(&kf->y, &kf->H, &kf->x_pred);
+        mat4x1SubInto(&kf->y, &kf->z, &kf->y);
+
+        kf->x_update = kf->x_pred;
+        mat5x4Mul4x1AddInto(&kf->x_update, &kf->steady.K, &kf->y);
+
+        kf->steady.phase = 0;
+        kf->P_update = kf->steady.P[0];
+    }
+    else
+    {
+        kalmanPredict(kf);
+        kalmanUpdate(kf);
+    }
+}
+
+
+static void kalmanFilterPredictOnly(KALMAN_T* kf)
+{
+    if(kf->mode == KALMAN_MODE_SQRT)
+    {
+        kalmanSqrtStep(kf, 0);
+        return;
+    }
+
+    if(kf->steady.enabled && (kf->steady.phase + 1 >= kf->steady.period))
+    {
+        // an update was skipped, the cycle no longer matches the cache
+        kalmanLeaveSteadyState(kf);
+    }
+
+    if(kf->steady.enabled)
+    {
+        kalmanPredictState(kf);
+        kf->x_update = kf->x_pred;
+
+        kf->steady.phase++;
+        kf->P_update = kf->steady.P[kf->steady.phase];
+        return;
+    }
+
+    if(kf->dt != kf->preint.dt)
+    {
+        // the tables are for another step size
+        kalmanPredict(kf);
+        kf->x_update = kf->x_pred;
+        kf->P_update = kf->P_pred;
+        return;
+    }
+
+    // nothing observes P until the next update, only the mean is stepped
+    // and the covariance catches up later from the preintegration tables
+    kalmanPredictState(kf);
+    kf->x_update = kf->x_pred;
+
+    kf->preint.pending++;
+    if(kf->preint.pending == KALMAN_PREINT_MAX)
+    {
+        kalmanFlushPrediction(kf);
+    }
+}
 
-    // A = PHT
-    MATRIX_T AT = matTranspose(&PHT);
-    MATRIX_T ST = matTranspose(&S);
-    // ST * KT =  AT
-    MATRIX_T KT = matSolve(&ST, &AT);
-    K = matTranspose(&KT);
+// stores the step just taken, history entry k holds the posterior of filter step k
+// together with the input and the measurements that went into it
+static void kalmanHistoryRecord(KALMAN_T* kf, unsigned char zMask)
+{
+    kf->step++;
+    if(!kf->history.enabled)
+    {
+        return;
+    }
+
+    KALMAN_HISTORY_ENTRY_T* entry = &(kf->history.entries[kf->step % KALMAN_HISTORY_LEN]);
+    entry->x = kf->x_update;
+    entry->P = kf->P_update;
+    entry->u = kf->u;
+    entry->z = kf->z;
+    entry->zMask = zMask;
+    entry->pending = kf->preint.pending;
+    entry->dt = kf->dt;
+
+    if(kf->history.count < KALMAN_HISTORY_LEN)
+    {
+        kf->history.count++;
+    }
+}
 
-    MATRIX_T Ky = matMul(&K, &y);
-    x_update = matAdd(&x_pred, &Ky);
+void kalmanStep(KALMAN_T* kf)
+{
+    kalmanFilterStep(kf);
+    kalmanHistoryRecord(kf, kf->zMask);
+
+#if TELEMETRY_ENABLED
+    if(kf->telemetry)
+    {
+        kalmanRecordTelemetry(kf, kf->steady.enabled ? &kf->steady.K : &kf->K);
+    }
+#endif
+}
 
-    MATRIX_T KH = matMul(&K, &H);
-    MATRIX_T IKH = matSub(&I, &KH);
-    MATRIX_T IKHT = matTranspose(&IKH);
-    MATRIX_T IKHP = matMul(&IKH, &P_pred);
-    MATRIX_T IKHPIKHT = matMul(&IKHP, &IKHT);
-    MATRIX_T KR = matMul(&K,&R);
-    MATRIX_T KRKT = matMul(&KR, &KT);
-    P_update = matAdd(&IKHPIKHT, &KRKT);
 
-    matPrint(&x_update);
+void kalmanStep_predictionOnly(KALMAN_T* kf)
+{
+    kalmanFilterPredictOnly(kf);
+    kalmanHistoryRecord(kf, 0);
 }
 
+// keeps the last KALMAN_HISTORY_LEN posteriors, inputs and measurements so
+// kalmanStepDelayed can fuse late measurements at their own step
+void kalmanEnableHistory(KALMAN_T* kf)
+{
+    KALMAN_HISTORY_ENTRY_T* entry = &(kf->history.entries[kf->step % KALMAN_HISTORY_LEN]);
+    entry->x = kf->x_update;
+    entry->P = kf->P_update;
+    entry->u = kf->u;
+    entry->z = kf->z;
+    entry->zMask = 0;
+    entry->pending = kf->preint.pending;
+    entry->dt = kf->dt;
+
+    kf->history.count = 1;
+    kf->history.enabled = 1;
+}
 
-void kalmanStep_predictionOnly()
+// fuses the components in mask of zInput, measured at filter step stamp
+// (kalmanStep/kalmanStep_predictionOnly calls since kalmanCreate), at that
+// step: the measurement joins the ones already stored for it, then the filter
+// is re-run from the posterior of step stamp - 1 with the stored inputs and
+// measurements, so a fix that is lag steps old costs lag + 1 filter steps.
+// a component already stored for that step is replaced.
+// returns 1 and leaves the filter unchanged if stamp is not in the history
+int kalmanStepDelayed(KALMAN_T* kf, MAT4X1_T* zInput, unsigned char mask, unsigned int stamp)
 {
-    MATRIX_T Fx = matMul(&F, &x_update);
-    MATRIX_T Bu = matMul(&B, &u);
-    x_pred = matAdd(&Fx, &Bu);
-    x_update = x_pred;
+    if(!kf->history.enabled || stamp == 0 || stamp > kf->step || kf->step - stamp + 1 >= kf->history.count)
+    {
+        return 1;
+    }
+
+    // the replay breaks the cached update cycle
+    kalmanLeaveSteadyState(kf);
+
+    KALMAN_HISTORY_ENTRY_T* entry = &(kf->history.entries[stamp % KALMAN_HISTORY_LEN]);
+    for(int iter = 0; iter < 4; iter++)
+    {
+        if(mask & (1 << iter)){entry->z.arr[iter] = zInput->arr[iter];}
+    }
+    entry->zMask |= mask;
+
+    // the model of the start step first, kalmanSetDt must not flush the
+    // restored pending steps with the current step size
+    KALMAN_HISTORY_ENTRY_T* start = &(kf->history.entries[(stamp - 1) % KALMAN_HISTORY_LEN]);
+    kalmanSetDt(kf, start->dt);
+    kf->x_update = start->x;
+    kf->P_update = start->P;
+    kf->preint.pending = start->pending;
+    if(kf->mode == KALMAN_MODE_SQRT)
+    {
+        kalmanFlushPrediction(kf);
+        kalmanSqrtFactorSym5(&kf->S_update, &kf->P_update);
+    }
+
+    for(unsigned int step = stamp; step <= kf->step; step++)
+    {
+        entry = &(kf->history.entries[step % KALMAN_HISTORY_LEN]);
+        kalmanSetDt(kf, entry->dt);
+        kf->u = entry->u;
+        kf->z = entry->z;
+        kf->zMask = entry->zMask;
+
+        if(entry->zMask)
+        {
+            kalmanFilterStep(kf);
+        }
+        else
+        {
+            kalmanFilterPredictOnly(kf);
+        }
+
+        entry->x = kf->x_update;
+        entry->P = kf->P_update;
+        entry->pending = kf->preint.pending;
+    }
+
+#if TELEMETRY_ENABLED
+    if(kf->telemetry)
+    {
+        kalmanRecordTelemetry(kf, &kf->K);
+    }
+#endif
+
+    return 0;
+}
 
-    MATRIX_T FP = matMul(&F, &P_update);
-    MATRIX_T FT = matTranspose(&F);
-    MATRIX_T FPFT = matMul(&FP, &FT);
-    P_pred = matAdd(&FPFT, &Q);
-    P_update = P_pred;
+// solves the periodic riccati recursion for a cycle of (period - 1) predictions
+// followed by one full update, then caches the gain and the covariance of every
+// phase. kalmanStep and kalmanStep_predictionOnly are then fixed gain and state
+// propagation only. the cycle is assumed to start right after an update.
+// returns 1 and stays on the full filter if the recursion does not converge
+int kalmanEnableSteadyState(KALMAN_T* kf, int period)
+{
+    kalmanLeaveSteadyState(kf);
+    kalmanFlushPrediction(kf);
+
+    // the cached gain replaces the covariance form only
+    if(kf->mode != KALMAN_MODE_STANDARD || period < 1 || period > KALMAN_STEADY_MAX_PERIOD)
+    {
+        return 1;
+    }
+
+    // only the covariance recursion runs, the filter itself is left alone
+    SYM5_T P = kf->P_update;
+    SYM5_T P_pred;
+    SYM5_T P_last = P;
+    MAT5X4_T K;
+    SYM4_T S;
+
+    for(int cycle = 0; cycle < KALMAN_STEADY_MAX_CYCLES; cycle++)
+    {
+        for(int step = 1; step < period; step++)
+        {
+            P_pred = kf->Q;
+            sym5Triple5x5AddInto(&P_pred, &kf->F, &P);
+            P = P_pred;
+        }
+        P_pred = kf->Q;
+        sym5Triple5x5AddInto(&P_pred, &kf->F, &P);
+
+        // batch gain, it works on the stacked innovation of a full update
+        kalmanDenseCovariance(kf, &kf->H, &kf->R, &P_pred, &P, &K, &S);
+
+        float change = 0;
+        for(int iter = 0; iter < 15; iter++)
+        {
+            float diff = fabsf(P.arr[iter] - P_last.arr[iter]) / (fabsf(P_last.arr[iter]) + 1e-12f);
+            if(diff > change){change = diff;}
+        }
+        P_last = P;
+
+        if(change < KALMAN_STEADY_TOL)
+        {
+            kf->steady.K = K;
+            kf->steady.S = S;
+
+            kf->steady.P[0] = P;
+            for(int step = 1; step < period; step++)
+            {
+                P_pred = kf->Q;
+                sym5Triple5x5AddInto(&P_pred, &kf->F, &P);
+                P = P_pred;
+                kf->steady.P[step] = P;
+            }
+
+            kf->steady.period = period;
+            kf->steady.phase = 0;
+            kf->steady.enabled = 1;
+            kf->P_update = kf->steady.P[0];
+            return 0;
+        }
+    }
+
+    return 1;
 }
 
-MATRIX_T kalmanGetState()
+MAT5X1_T kalmanGetState(KALMAN_T* kf)
 {
-    return x_update;
-}
\ No newline at end of file
+    return kf->x_update;
+}
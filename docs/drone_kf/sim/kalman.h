@@ -1,13 +1,135 @@
 #ifndef KALMAN_H
 #define KALMAN_H
 
-#include "linalg.h"
+#include "linalgFixed.h"
+#include "telemetry.h"
+#include "linalgDyn.h"
 
-void setupKalman(float dt);
-void kalman_u_InputStep(MATRIX_T* uInput, float angle);
-void kalman_z_InputStep(MATRIX_T* zInput);
-void kalmanStep();
-void kalmanStep_predictionOnly();
-MATRIX_T kalmanGetState();
+// estimator modes, see kalmanSetMode
+#define KALMAN_MODE_STANDARD 0 // covariance form, joseph update
+#define KALMAN_MODE_SQRT     1 // propagates a triangular factor of P through QR
 
-#endif
\ No newline at end of file
+#define KALMAN_SQRT_SCRATCH_BYTES 2048 // stack scratch for the square root step when kf->scratch is NULL
+
+// measurement components in z, used as a mask for partial updates
+#define KALMAN_Z_POS_X (1 << 0)
+#define KALMAN_Z_POS_Y (1 << 1)
+#define KALMAN_Z_VEL_X (1 << 2)
+#define KALMAN_Z_VEL_Y (1 << 3)
+#define KALMAN_Z_POS   (KALMAN_Z_POS_X | KALMAN_Z_POS_Y)
+#define KALMAN_Z_VEL   (KALMAN_Z_VEL_X | KALMAN_Z_VEL_Y)
+#define KALMAN_Z_ALL   (KALMAN_Z_POS | KALMAN_Z_VEL)
+
+#define KALMAN_STEADY_MAX_PERIOD 32 // longest measurement cycle the steady state mode caches
+#define KALMAN_STEADY_MAX_CYCLES 1000 // riccati iterations before giving up
+#define KALMAN_STEADY_TOL 1e-5f // relative change of P per cycle counted as converged
+
+// cached periodic steady state of a time invariant filter
+typedef struct{
+    int enabled;
+    int period; // steps per measurement cycle, the last one carries the update
+    int phase;  // steps since the last update
+    MAT5X4_T K; // converged gain of the update step
+    SYM4_T S;   // converged innovation covariance
+    SYM5_T P[KALMAN_STEADY_MAX_PERIOD]; // P[0] after the update, P[j] after j predictions
+} KALMAN_STEADY_T;
+
+#define KALMAN_DT_CACHE_LEN 4 // step sizes kept discretized, see kalmanSetDt
+
+// model discretized for one step size
+typedef struct{
+    float dt;
+    MAT5X5_T F;
+    MAT5X2_T B;
+    SYM5_T Q;
+    MAT5X5_T Q_sqrt;
+} KALMAN_DISCRETE_T;
+
+typedef struct{
+    KALMAN_DISCRETE_T entries[KALMAN_DT_CACHE_LEN];
+    int count;
+    int next; // entry replaced by the next miss
+} KALMAN_DT_CACHE_T;
+
+#define KALMAN_PREINT_MAX 16 // prediction steps the covariance may lag behind the mean
+
+// deferred covariance propagation. between updates only the mean is stepped,
+// P catches up in one go with F^n P F^n^T + Q_n from the tables
+typedef struct{
+    int pending;                   // steps P_update lags behind x_update
+    float dt;                      // step size the tables are built for
+    MAT5X5_T F_pow[KALMAN_PREINT_MAX]; // F^(n+1)
+    SYM5_T Q_sum[KALMAN_PREINT_MAX];   // Q_(n+1) = sum_j F^j Q F^j^T, j = 0..n
+} KALMAN_PREINT_T;
+
+#define KALMAN_HISTORY_LEN 64 // filter steps kept for delayed measurements
+
+typedef struct{
+    MAT5X1_T x;  // posterior state after the step
+    SYM5_T P;    // posterior covariance after the step
+    MAT2X1_T u;  // input of the prediction into the step
+    MAT4X1_T z;  // measurements fused at the step
+    unsigned char zMask; // KALMAN_Z_* components of z, 0 for prediction only
+    int pending; // steps P lags behind x, see KALMAN_PREINT_T
+    float dt;    // step size of the prediction into the step
+} KALMAN_HISTORY_ENTRY_T;
+
+// ring of the last steps, entry of step k at k % KALMAN_HISTORY_LEN
+typedef struct{
+    int enabled;
+    unsigned int count; // valid entries, the newest is the current step
+    KALMAN_HISTORY_ENTRY_T entries[KALMAN_HISTORY_LEN];
+} KALMAN_HISTORY_T;
+
+// one filter instance, everything the filter touches lives in here
+// so any number of filters can run side by side (or on different threads)
+typedef struct{
+    // covariances are packed symmetric, see fixedSymIdx
+    SYM5_T P_pred;  //state covariance prediction
+    SYM5_T P_update; // state covariance update
+    SYM5_T Q; // covariance process noise
+    SYM4_T R; // covariance sensor noise
+    MAT5X5_T S_pred;   // square root mode, upper triangular with P_pred = S_pred^T S_pred
+    MAT5X5_T S_update; // square root mode, P_update = S_update^T S_update
+    MAT5X5_T Q_sqrt;   // upper triangular factor of Q
+    MAT4X5_T H; // sensor mapping
+    MAT5X1_T x_pred; //state prediction
+    MAT5X1_T x_update; //state update
+    MAT4X1_T y; //inovation
+    MAT5X5_T F; //state transition
+    MAT5X2_T B; //input effect
+    MAT2X1_T u; //input
+    MAT4X1_T z; //sensor
+    SYM4_T S; //innovation covariance
+    MAT5X4_T K; //kalman gain
+    MAT5X5_T I; //identity matrix
+    MAT2X2_T rotation_wb;
+    unsigned char zMask; // KALMAN_Z_* components present in z
+    int sequentialUpdate; // R is diagonal, update one scalar component at a time
+    int mode; // KALMAN_MODE_*
+    KALMAN_STEADY_T steady;
+    KALMAN_PREINT_T preint;
+    float dt; // step size F, B and Q are discretized for
+    KALMAN_DT_CACHE_T dtCache;
+    unsigned int step; // filter steps since kalmanCreate
+    KALMAN_HISTORY_T history;
+    TELEMETRY_RING_T* telemetry; // one record per update when set, NULL to skip
+    ARENA_T* scratch; // square root mode matrices when set, NULL for the stack
+} KALMAN_T;
+
+void kalmanCreate(KALMAN_T* kf, float dt);
+void kalman_u_InputStep(KALMAN_T* kf, MAT2X1_T* uInput, float angle);
+void kalman_z_InputStep(KALMAN_T* kf, MAT4X1_T* zInput);
+void kalman_z_InputStepMasked(KALMAN_T* kf, MAT4X1_T* zInput, unsigned char mask);
+void kalmanModelChanged(KALMAN_T* kf);
+void kalmanSetMode(KALMAN_T* kf, int mode);
+void kalmanSetDt(KALMAN_T* kf, float dt);
+int  kalmanEnableSteadyState(KALMAN_T* kf, int period);
+void kalmanStep(KALMAN_T* kf);
+void kalmanStep_predictionOnly(KALMAN_T* kf);
+void kalmanFlushPrediction(KALMAN_T* kf);
+void kalmanEnableHistory(KALMAN_T* kf);
+int  kalmanStepDelayed(KALMAN_T* kf, MAT4X1_T* zInput, unsigned char mask, unsigned int stamp);
+MAT5X1_T kalmanGetState(KALMAN_T* kf);
+
+#endif
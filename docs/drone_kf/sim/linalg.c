@@ -1,4 +1,6 @@
 #include "linalg.h"
+#include "linalgDyn.h"
+#include "linalgSimd.h"
 #include "string.h"
 #include <stdio.h>
 #include <math.h>
@@ -6,161 +8,374 @@
 
 
 
+// in place API ----------
+// X is written, A and B are only read. X must not alias A or B for the
+// multiplications and transposes, the elementwise ops allow it.
+
 // X = A + B
-MATRIX_T matAdd(MATRIX_T* A, MATRIX_T* B) 
+void matAddInto(MATRIX_T* X, MATRIX_T* A, MATRIX_T* B)
 {
-
-    MATRIX_T X;
-
     // check correct dimension
     if(!((A->rows == B->rows) && (A->cols == B->cols)))
     {
          // mismatch in dimentions
     }
 
-    X.cols = A->cols;
-    X.rows = A->rows;
+    X->cols = A->cols;
+    X->rows = A->rows;
 
+#if LINALG_SIMD
+    simdAdd(X->arr, A->arr, B->arr, A->rows*A->cols);
+#else
     for(int iter = 0; iter < (A->rows*A->cols); iter++ )
     {
-        X.arr[iter] = A->arr[iter] + B->arr[iter];
+        X->arr[iter] = A->arr[iter] + B->arr[iter];
     }
-
-    return X;
+#endif
 }
 
 // X = A - B
-MATRIX_T matSub(MATRIX_T* A, MATRIX_T* B) 
+void matSubInto(MATRIX_T* X, MATRIX_T* A, MATRIX_T* B)
 {
-
-    MATRIX_T X;
     // check correct dimension
     if(!((A->rows == B->rows) && (A->cols == B->cols)))
     {
          // mismatch in dimentions
     }
 
-    X.cols = A->cols;
-    X.rows = A->rows;
-
+    X->cols = A->cols;
+    X->rows = A->rows;
 
+#if LINALG_SIMD
+    simdSub(X->arr, A->arr, B->arr, A->rows*A->cols);
+#else
     for(int iter = 0; iter < (A->rows*A->cols); iter++ )
     {
-        X.arr[iter] = A->arr[iter] - B->arr[iter];
+        X->arr[iter] = A->arr[iter] - B->arr[iter];
     }
-
-    return X;
+#endif
 }
 
-
-// X = A * B
-MATRIX_T matMul(MATRIX_T* A, MATRIX_T* B) 
+// MATRIX_T storage seen through the dynamic kernels
+static inline MATRIXD_T matView(MATRIX_T* A)
 {
-    MATRIX_T X;
+    MATRIXD_T view;
+    view.arr = A->arr;
+    view.rows = A->rows;
+    view.cols = A->cols;
+    return view;
+}
 
+// X (+)= op(A) * op(B), op is either identity or transpose
+static void matMulKernel(MATRIX_T* X, MATRIX_T* A, MATRIX_T* B, int transA, int transB, int accumulate)
+{
     // check correct dimension
-    if(!((A->cols == B->rows)))
+    if(!((transA ? A->rows : A->cols) == (transB ? B->cols : B->rows)))
     {
          // mismatch in dimentions
     }
 
-    X.rows = A->rows;
-    X.cols = B->cols;
+    X->rows = transA ? A->cols : A->rows;
+    X->cols = transB ? B->rows : B->cols;
 
-    //X->arr[0] = A->arr[0]*B->arr[0] + A->arr[1]*B->arr[B->cols] + A->arr[2]*B->arr[B->cols * 2]
+    MATRIXD_T Xv = matView(X);
+    MATRIXD_T Av = matView(A);
+    MATRIXD_T Bv = matView(B);
+    matdMulKernel(&Xv, &Av, &Bv, transA, transB, accumulate);
+}
 
-    memset(X.arr, 0, 4* A->rows * B->cols);
+// X = A * B
+void matMulInto(MATRIX_T* X, MATRIX_T* A, MATRIX_T* B)
+{
+    matMulKernel(X, A, B, 0, 0, 0);
+}
 
-    for(int rightIter = 0; rightIter < B->cols; rightIter++)
+// X += A * B
+void matMulAddInto(MATRIX_T* X, MATRIX_T* A, MATRIX_T* B)
+{
+    matMulKernel(X, A, B, 0, 0, 1);
+}
+
+// X = A * B^T
+void matMulTransBInto(MATRIX_T* X, MATRIX_T* A, MATRIX_T* B)
+{
+    matMulKernel(X, A, B, 0, 1, 0);
+}
+
+// X += A * B^T
+void matMulTransBAddInto(MATRIX_T* X, MATRIX_T* A, MATRIX_T* B)
+{
+    matMulKernel(X, A, B, 0, 1, 1);
+}
+
+// X = A^T * B
+void matMulTransAInto(MATRIX_T* X, MATRIX_T* A, MATRIX_T* B)
+{
+    matMulKernel(X, A, B, 1, 0, 0);
+}
+
+// X = A^T
+void matTransposeInto(MATRIX_T* X, MATRIX_T* A)
+{
+    X->cols = A->rows;
+    X->rows = A->cols;
+
+    for(int A_row = 0; A_row < A->rows; A_row++)
     {
-        for(int downIter = 0; downIter < A->rows; downIter++)
+        for(int A_col = 0; A_col < A->cols; A_col++)
         {
-            for(int iter = 0; iter < A->cols; iter++)
-            {
-                X.arr[ X.cols * downIter + rightIter] += A->arr[iter + downIter * A->cols] * B->arr[iter * B->cols + rightIter];
-            }
+            matSet(X, matGet(A, A_row, A_col), A_col, A_row);
         }
     }
+}
 
-    return X;
+// X = A * s
+void matTimesScalarInto(MATRIX_T* X, MATRIX_T* A, float s)
+{
+    X->rows = A->rows;
+    X->cols = A->cols;
+
+#if LINALG_SIMD
+    simdScale(X->arr, A->arr, s, A->cols * A->rows);
+#else
+    for(int iter = 0; iter < (A->cols * A->rows); iter++)
+    {
+        X->arr[iter] = A->arr[iter] * s;
+    }
+#endif
 }
 
-// A^T
-MATRIX_T matTranspose(MATRIX_T* A)
+// X = A, only the used part of arr is copied
+void matCopyInto(MATRIX_T* X, MATRIX_T* A)
 {
-    MATRIX_T AT;
-    AT.cols = A->rows;
-    AT.rows = A->cols;
+    X->rows = A->rows;
+    X->cols = A->cols;
+    memcpy(X->arr, A->arr, sizeof(float) * A->rows * A->cols);
+}
 
-    for(int A_row = 0; A_row < A->rows; A_row++)
+void matEyeInto(MATRIX_T* X, int numdim)
+{
+    X->rows = numdim;
+    X->cols = numdim;
+
+    memset(X->arr, 0, sizeof(float) * numdim * numdim);
+    for(int iter = 0; iter < numdim; iter++)
     {
-        for(int A_col = 0; A_col < A->cols; A_col++)
+        matSet(X, 1, iter, iter);
+    }
+}
+
+void matExtractColInto(MATRIX_T* X, MATRIX_T* A, int selectedColumn)
+{
+    X->cols = 1;
+    X->rows = A->rows;
+
+    for(int row = 0; row < X->rows; row++)
+    {
+        X->arr[row] = A->arr[row * A->cols + selectedColumn];
+    }
+}
+
+// X = I - 2 u u^T / u^T u
+void matHouseholderInto(MATRIX_T* X, MATRIX_T* u)
+{
+    float uTu = matScalarProduct(u);
+
+    matMulTransBInto(X, u, u);
+    for(int iter = 0; iter < (X->rows * X->cols); iter++)
+    {
+        X->arr[iter] *= -2 / uTu;
+    }
+    for(int iter = 0; iter < X->rows; iter++)
+    {
+        X->arr[iter * X->cols + iter] += 1;
+    }
+}
+
+// householder QR in compact form, see matdQRCompactInPlace
+void matQRCompactInto(QR_COMPACT_T* qr, MATRIX_T* X)
+{
+    QRD_T view;
+
+    matCopyInto(&(qr->QR), X);
+    view.QR = matView(&(qr->QR));
+    view.tau = qr->tau;
+    matdQRCompactInPlace(&view);
+    qr->steps = view.steps;
+}
+
+// B = Q^T * B, reflectors applied in order without forming Q
+void matQTMulInPlace(QR_COMPACT_T* qr, MATRIX_T* B)
+{
+    QRD_T view;
+    MATRIXD_T Bv = matView(B);
+
+    view.QR = matView(&(qr->QR));
+    view.tau = qr->tau;
+    view.steps = qr->steps;
+    matdQTMulInPlace(&view, &Bv);
+}
+
+// explicit Q and R from the compact form, only needed when Q itself is wanted
+void matQRInto(QR_T* qr, MATRIX_T* X)
+{
+    QR_COMPACT_T compact;
+    QRD_T view;
+    MATRIXD_T Qv;
+
+    matQRCompactInto(&compact, X);
+
+    // R is the upper triangle
+    qr->R.rows = X->rows;
+    qr->R.cols = X->cols;
+    for(int row = 0; row < X->rows; row++)
+    {
+        for(int col = 0; col < X->cols; col++)
         {
-            matSet(&AT, matGet(A, A_row, A_col), A_col, A_row);
+            matSet(&(qr->R), (col >= row) ? matGet(&(compact.QR), row, col) : 0, row, col);
         }
     }
 
-    return AT;
+    qr->Q.rows = X->rows;
+    qr->Q.cols = X->rows;
+    Qv = matView(&(qr->Q));
+    view.QR = matView(&(compact.QR));
+    view.tau = compact.tau;
+    view.steps = compact.steps;
+    matdQFromCompactInto(&Qv, &view);
 }
 
-// vector a^T * a
-float matScalarProduct(MATRIX_T* a)
+// upper triangular backsubstitution R*X = B
+// only the top R->cols rows of R and B are used, so a tall R from a least
+// squares QR works as well
+void matRBSInto(MATRIX_T* X, MATRIX_T* R, MATRIX_T* B)
 {
-    MATRIX_T aT;
-    aT = matTranspose(a);
+    X->rows = R->cols;
+    X->cols = B->cols;
+
+    MATRIXD_T Xv = matView(X);
+    MATRIXD_T Rv = matView(R);
+    MATRIXD_T Bv = matView(B);
+    matdRBSInto(&Xv, &Rv, &Bv);
+}
 
-    MATRIX_T aTa;
-    aTa = matMul(&aT, a);
+//A * X = B, least squares if A is tall
+void matSolveInto(MATRIX_T* X, MATRIX_T* A, MATRIX_T* B)
+{
+    QR_COMPACT_T A_QR;
+    MATRIX_T QTB;
 
-    return aTa.arr[0];
+    matQRCompactInto(&A_QR, A);
+    matCopyInto(&QTB, B);
+    matQTMulInPlace(&A_QR, &QTB);
+    matRBSInto(X, &(A_QR.QR), &QTB);
 }
 
-MATRIX_T matOuterProduct(MATRIX_T* a)
+// cholesky A = L L^T for symmetric positive definite A, only the lower
+// triangle of A is read. returns 1 if A is not positive definite
+int matCholeskyInto(MATRIX_T* L, MATRIX_T* A)
 {
-    MATRIX_T aT;
-    aT = matTranspose(a);
+    L->rows = A->rows;
+    L->cols = A->rows;
 
-    MATRIX_T aaT;
-    aaT = matMul(&aT, a);
+    MATRIXD_T Lv = matView(L);
+    MATRIXD_T Av = matView(A);
+    return matdCholeskyInto(&Lv, &Av);
+}
 
-    return aaT;
+// L L^T X = B, forward then back substitution
+void matCholeskySolveInto(MATRIX_T* X, MATRIX_T* L, MATRIX_T* B)
+{
+    X->rows = L->rows;
+    X->cols = B->cols;
+
+    MATRIXD_T Xv = matView(X);
+    MATRIXD_T Lv = matView(L);
+    MATRIXD_T Bv = matView(B);
+    matdCholeskySolveInto(&Xv, &Lv, &Bv);
 }
 
-MATRIX_T matTimesScalar(MATRIX_T* A, float s)
+// A * X = B for symmetric A, cholesky if A is positive definite, QR otherwise
+void matSolveSymInto(MATRIX_T* X, MATRIX_T* A, MATRIX_T* B)
 {
-    MATRIX_T X;
-    X.rows = A->rows;
-    X.cols = A->cols;
+    MATRIX_T L;
 
-    for(int iter = 0; iter < (A->cols * A->rows); iter++)
+    if(matCholeskyInto(&L, A))
     {
-        X.arr[iter] = A->arr[iter] * s;
+        matSolveInto(X, A, B);
+        return;
     }
+    matCholeskySolveInto(X, &L, B);
+}
+
 
+
+// by value API, thin wrappers around the in place functions ----------
+
+// X = A + B
+MATRIX_T matAdd(MATRIX_T* A, MATRIX_T* B) 
+{
+    MATRIX_T X;
+    matAddInto(&X, A, B);
     return X;
 }
 
-MATRIX_T matEye(int numdim)
+// X = A - B
+MATRIX_T matSub(MATRIX_T* A, MATRIX_T* B) 
 {
     MATRIX_T X;
+    matSubInto(&X, A, B);
+    return X;
+}
 
-    X.rows = numdim;
-    X.cols = numdim;
+// X = A * B
+MATRIX_T matMul(MATRIX_T* A, MATRIX_T* B) 
+{
+    MATRIX_T X;
+    matMulInto(&X, A, B);
+    return X;
+}
 
-    for(int iterRow = 0; iterRow < numdim; iterRow++)
+// A^T
+MATRIX_T matTranspose(MATRIX_T* A)
+{
+    MATRIX_T AT;
+    matTransposeInto(&AT, A);
+    return AT;
+}
+
+// vector a^T * a
+float matScalarProduct(MATRIX_T* a)
+{
+    float sum = 0;
+
+    for(int iter = 0; iter < a->rows; iter++)
     {
-        for(int iterCol = 0; iterCol < numdim; iterCol++)
-        {
-            if(iterCol == iterRow)
-            {
-                matSet(&X, 1, iterRow, iterCol);
-            }
-            else
-            {
-                matSet(&X, 0, iterRow, iterCol);
-            }
-        }
+        sum += a->arr[iter] * a->arr[iter];
     }
+
+    return sum;
+}
+
+// vector a * a^T
+MATRIX_T matOuterProduct(MATRIX_T* a)
+{
+    MATRIX_T aaT;
+    matMulTransBInto(&aaT, a, a);
+    return aaT;
+}
+
+MATRIX_T matTimesScalar(MATRIX_T* A, float s)
+{
+    MATRIX_T X;
+    matTimesScalarInto(&X, A, s);
+    return X;
+}
+
+MATRIX_T matEye(int numdim)
+{
+    MATRIX_T X;
+    matEyeInto(&X, numdim);
     return X;
 }
 
@@ -197,123 +412,45 @@ MATRIX_T matBasisVector(float numRows, int place)
 }
 
 // H = I - 2 v v^T
-MATRIX_T matHouseholder(MATRIX_T* I, MATRIX_T* u)
+MATRIX_T matHouseholder(MATRIX_T* u)
 {
-    
-    MATRIX_T u2 = matTimesScalar(u, 2);
-    MATRIX_T uT = matTranspose(u);
-    float uTu = matScalarProduct(u);
-
-    MATRIX_T u2uT = matMul(&u2, &uT);
-    MATRIX_T u2uT_D_uTu = matTimesScalar(&u2uT, 1/uTu);
-
-
-    return matSub(I, &u2uT_D_uTu);
+    MATRIX_T H;
+    matHouseholderInto(&H, u);
+    return H;
 }
 
 MATRIX_T matExtractCol(MATRIX_T* A, int selectedColumn)
 {
     MATRIX_T X;
-    
-    X.cols = 1;
-    X.rows = A->rows;
-
-
-    for(int row = 0; row < X.rows; row++)
-    {
-        X.arr[row] = A->arr[row * A->cols + selectedColumn];
-    }
-
+    matExtractColInto(&X, A, selectedColumn);
     return X;
 }
 
 float matVecMag(MATRIX_T* v)
 {
-    float sum = 0;
-    
-    for(int iter = 0; iter < v->rows; iter++)
-    {
-        sum += v->arr[iter] * v->arr[iter];
-    }
-
-    return sqrtf(sum);
+    return sqrtf(matScalarProduct(v));
 }
 
 QR_T matQR(MATRIX_T* X)
 {   
     QR_T qr;
-
-    qr.Q = matEye(X->rows);
-    qr.R = *X;
-
-    for(int iter = 0; iter < X->rows-1; iter++)
-    {
-        MATRIX_T eb = matBasisVector(qr.R.rows, iter);
-        MATRIX_T xc = matExtractCol(&(qr.R),iter);
-
-        for(int zeroIter = 0; zeroIter < iter; zeroIter++)
-        {
-            matSet(&xc, 0, zeroIter, 0);
-        }
-
-        float xcMag = matVecMag(&xc);
-        
-        MATRIX_T ebs = matTimesScalar(&eb, xcMag);
-        
-        MATRIX_T I = matEye(qr.R.rows);
-        MATRIX_T u = matSub(&xc, &ebs);
-
-        MATRIX_T H = matHouseholder(&I, &u);
-        qr.Q = matMul(&H, &(qr.Q));
-        qr.R = matMul(&H, &(qr.R));
-    }
-
-    qr.Q = matTranspose(&(qr.Q));
-
+    matQRInto(&qr, X);
     return qr;
 }
 
 //A * X = B
 MATRIX_T matSolve(MATRIX_T* A, MATRIX_T* B)
 {
-
-    QR_T A_QR = matQR(A);
-
-    MATRIX_T QT  = matTranspose(&(A_QR.Q));
-    MATRIX_T QTB = matMul(&QT, B);
-
-    return matRBS(&(A_QR.R), &QTB);
-
+    MATRIX_T X;
+    matSolveInto(&X, A, B);
+    return X;
 }
 
 // upper triangular backsubstitution R*X = B
 MATRIX_T matRBS(MATRIX_T* R, MATRIX_T* B)
 {
-    float den = 0;
-    float num = 0;
-
     MATRIX_T X;
-    X.rows = R->cols;
-    X.cols = B->cols;
-
-
-    for(int colB = 0; colB < B->cols; colB++)
-    {
-        for(int rowR = R->rows-1; rowR >= 0; rowR--)
-        {
-
-            num = matGet(B, rowR, colB);
-
-            for(int iter = rowR + 1; iter < R->rows; iter++)
-            {
-                num -= matGet(R, rowR, iter) * matGet(&X, iter, colB);
-            }
-            den = matGet(R, rowR, rowR);
-
-            matSet(&X, num/den, rowR, colB);
-        }
-    }
-
+    matRBSInto(&X, R, B);
     return X;
 }
 
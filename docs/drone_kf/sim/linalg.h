@@ -5,7 +5,7 @@ typedef struct{
     // Matrix [10 20
     //         30 40]
     // is stored as [10 20 30 40]
-    float arr[32]; // wasteful and doesnt work for larger matrices
+    float arr[32]; // small matrices only, larger ones use MATRIXD_T in linalgDyn.h
     char cols;
     char rows;
 } MATRIX_T;
@@ -15,7 +15,39 @@ typedef struct{
     MATRIX_T R;
 } QR_T;
 
+typedef struct{
+    // R on and above the diagonal, householder vectors below it with their
+    // leading 1 implied, H_k = I - tau[k] v_k v_k^T and Q = H_0 * H_1 * ...
+    MATRIX_T QR;
+    float tau[8];
+    int steps;
+} QR_COMPACT_T;
+
+
+// in place API, results are written to the first argument
+void matAddInto(MATRIX_T* , MATRIX_T* , MATRIX_T* );
+void matSubInto(MATRIX_T* , MATRIX_T* , MATRIX_T* );
+void matMulInto(MATRIX_T* , MATRIX_T* , MATRIX_T* );
+void matMulAddInto(MATRIX_T* , MATRIX_T* , MATRIX_T* );
+void matMulTransBInto(MATRIX_T* , MATRIX_T* , MATRIX_T* );
+void matMulTransBAddInto(MATRIX_T* , MATRIX_T* , MATRIX_T* );
+void matMulTransAInto(MATRIX_T* , MATRIX_T* , MATRIX_T* );
+void matTransposeInto(MATRIX_T* , MATRIX_T* );
+void matTimesScalarInto(MATRIX_T* , MATRIX_T* , float );
+void matCopyInto(MATRIX_T* , MATRIX_T* );
+void matEyeInto(MATRIX_T* , int );
+void matExtractColInto(MATRIX_T* , MATRIX_T* , int );
+void matHouseholderInto(MATRIX_T* , MATRIX_T* );
+void matQRCompactInto(QR_COMPACT_T* , MATRIX_T* );
+void matQTMulInPlace(QR_COMPACT_T* , MATRIX_T* );
+void matQRInto(QR_T* , MATRIX_T* );
+void matRBSInto(MATRIX_T* , MATRIX_T* , MATRIX_T* );
+void matSolveInto(MATRIX_T* , MATRIX_T* , MATRIX_T* );
+int  matCholeskyInto(MATRIX_T* , MATRIX_T* );
+void matCholeskySolveInto(MATRIX_T* , MATRIX_T* , MATRIX_T* );
+void matSolveSymInto(MATRIX_T* , MATRIX_T* , MATRIX_T* );
 
+// by value API
 MATRIX_T matAdd(MATRIX_T* , MATRIX_T* ) ;
 MATRIX_T matSub(MATRIX_T* , MATRIX_T* ) ;
 MATRIX_T matMul(MATRIX_T* , MATRIX_T* ) ;
@@ -0,0 +1,442 @@
+#include "linalgDyn.h"
+#include "linalgSimd.h"
+#include <string.h>
+#include <math.h>
+
+
+// allocation ----------
+
+// arr is NULL and the shape 0x0 if the arena is exhausted
+MATRIXD_T matdAlloc(ARENA_T* arena, int rows, int cols)
+{
+    MATRIXD_T X;
+
+    X.arr = arenaAlloc(arena, sizeof(float) * rows * cols);
+    X.rows = X.arr ? rows : 0;
+    X.cols = X.arr ? cols : 0;
+
+    return X;
+}
+
+MATRIXD_T matdZeros(ARENA_T* arena, int rows, int cols)
+{
+    MATRIXD_T X = matdAlloc(arena, rows, cols);
+
+    if(X.arr)
+    {
+        memset(X.arr, 0, sizeof(float) * rows * cols);
+    }
+
+    return X;
+}
+
+MATRIXD_T matdEye(ARENA_T* arena, int numdim)
+{
+    MATRIXD_T X = matdZeros(arena, numdim, numdim);
+
+    for(int iter = 0; iter < X.rows; iter++)
+    {
+        matdSet(&X, 1, iter, iter);
+    }
+
+    return X;
+}
+
+
+// elementwise ----------
+
+void matdCopyInto(MATRIXD_T* X, MATRIXD_T* A)
+{
+    memcpy(X->arr, A->arr, sizeof(float) * A->rows * A->cols);
+}
+
+// X = A + B
+void matdAddInto(MATRIXD_T* X, MATRIXD_T* A, MATRIXD_T* B)
+{
+#if LINALG_SIMD
+    simdAdd(X->arr, A->arr, B->arr, A->rows * A->cols);
+#else
+    for(int iter = 0; iter < (A->rows * A->cols); iter++)
+    {
+        X->arr[iter] = A->arr[iter] + B->arr[iter];
+    }
+#endif
+}
+
+// X = A - B
+void matdSubInto(MATRIXD_T* X, MATRIXD_T* A, MATRIXD_T* B)
+{
+#if LINALG_SIMD
+    simdSub(X->arr, A->arr, B->arr, A->rows * A->cols);
+#else
+    for(int iter = 0; iter < (A->rows * A->cols); iter++)
+    {
+        X->arr[iter] = A->arr[iter] - B->arr[iter];
+    }
+#endif
+}
+
+// X = A * s
+void matdTimesScalarInto(MATRIXD_T* X, MATRIXD_T* A, float s)
+{
+#if LINALG_SIMD
+    simdScale(X->arr, A->arr, s, A->rows * A->cols);
+#else
+    for(int iter = 0; iter < (A->rows * A->cols); iter++)
+    {
+        X->arr[iter] = A->arr[iter] * s;
+    }
+#endif
+}
+
+// X = A^T
+void matdTransposeInto(MATRIXD_T* X, MATRIXD_T* A)
+{
+    for(int row = 0; row < A->rows; row++)
+    {
+        for(int col = 0; col < A->cols; col++)
+        {
+            X->arr[col * A->rows + row] = A->arr[row * A->cols + col];
+        }
+    }
+}
+
+
+// products ----------
+
+// X (+)= op(A) * op(B), op is either identity or transpose
+// X is rows(op(A)) x cols(op(B)) and must not alias A or B
+void matdMulKernel(MATRIXD_T* X, MATRIXD_T* A, MATRIXD_T* B, int transA, int transB, int accumulate)
+{
+    int rows  = transA ? A->cols : A->rows;
+    int inner = transA ? A->rows : A->cols;
+    int cols  = transB ? B->rows : B->cols;
+
+    if(!transB)
+    {
+        // row outer, B is walked along its rows
+        int aStride = transA ? A->cols : 1;
+
+        for(int downIter = 0; downIter < rows; downIter++)
+        {
+            float* a = transA ? &(A->arr[downIter]) : &(A->arr[downIter * A->cols]);
+#if LINALG_SIMD
+            simdMulRow(&(X->arr[downIter * cols]), a, aStride, B->arr, inner, cols, accumulate);
+#else
+            for(int rightIter = 0; rightIter < cols; rightIter++)
+            {
+                float sum = 0;
+                for(int iter = 0; iter < inner; iter++)
+                {
+                    sum += a[iter * aStride] * B->arr[iter * cols + rightIter];
+                }
+                X->arr[downIter * cols + rightIter] = accumulate ? X->arr[downIter * cols + rightIter] + sum : sum;
+            }
+#endif
+        }
+        return;
+    }
+
+    // B transposed, every element is a dot product of two rows
+    for(int downIter = 0; downIter < rows; downIter++)
+    {
+        for(int rightIter = 0; rightIter < cols; rightIter++)
+        {
+            float sum = 0;
+            for(int iter = 0; iter < inner; iter++)
+            {
+                float a = transA ? A->arr[iter * A->cols + downIter] : A->arr[downIter * A->cols + iter];
+                sum += a * B->arr[rightIter * B->cols + iter];
+            }
+
+            if(accumulate)
+            {
+                X->arr[downIter * cols + rightIter] += sum;
+            }
+            else
+            {
+                X->arr[downIter * cols + rightIter] = sum;
+            }
+        }
+    }
+}
+
+// X = A * B
+void matdMulInto(MATRIXD_T* X, MATRIXD_T* A, MATRIXD_T* B)
+{
+    matdMulKernel(X, A, B, 0, 0, 0);
+}
+
+// X += A * B
+void matdMulAddInto(MATRIXD_T* X, MATRIXD_T* A, MATRIXD_T* B)
+{
+    matdMulKernel(X, A, B, 0, 0, 1);
+}
+
+// X = A * B^T
+void matdMulTransBInto(MATRIXD_T* X, MATRIXD_T* A, MATRIXD_T* B)
+{
+    matdMulKernel(X, A, B, 0, 1, 0);
+}
+
+// X += A * B^T
+void matdMulTransBAddInto(MATRIXD_T* X, MATRIXD_T* A, MATRIXD_T* B)
+{
+    matdMulKernel(X, A, B, 0, 1, 1);
+}
+
+// X = A^T * B
+void matdMulTransAInto(MATRIXD_T* X, MATRIXD_T* A, MATRIXD_T* B)
+{
+    matdMulKernel(X, A, B, 1, 0, 0);
+}
+
+
+// decompositions ----------
+
+// householder QR in compact form, O(rows*cols^2), works on qr->QR in place
+// every reflector H_k = I - tau_k v_k v_k^T is applied to the remaining
+// columns as a rank 1 update, v_k is stored below the diagonal of R
+// qr->tau needs room for min(rows - 1, cols) floats
+void matdQRCompactInPlace(QRD_T* qr)
+{
+    MATRIXD_T* A = &(qr->QR);
+    int rows = A->rows;
+    int cols = A->cols;
+
+    qr->steps = (rows - 1 < cols) ? rows - 1 : cols;
+
+    for(int k = 0; k < qr->steps; k++)
+    {
+        float norm = 0;
+        for(int row = k; row < rows; row++)
+        {
+            norm += matdGet(A, row, k) * matdGet(A, row, k);
+        }
+        norm = sqrtf(norm);
+
+        if(norm == 0)
+        {
+            qr->tau[k] = 0;
+            continue;
+        }
+
+        // v = x - alpha*e_k, sign of alpha chosen to avoid cancellation,
+        // then scaled so that v[k] = 1
+        float x0 = matdGet(A, k, k);
+        float alpha = (x0 > 0) ? -norm : norm;
+        float v0 = x0 - alpha;
+
+        for(int row = k + 1; row < rows; row++)
+        {
+            matdSet(A, matdGet(A, row, k) / v0, row, k);
+        }
+        qr->tau[k] = (alpha - x0) / alpha;
+        matdSet(A, alpha, k, k);
+
+        for(int col = k + 1; col < cols; col++)
+        {
+            float s = matdGet(A, k, col);
+            for(int row = k + 1; row < rows; row++)
+            {
+                s += matdGet(A, row, k) * matdGet(A, row, col);
+            }
+            s *= qr->tau[k];
+
+            matdSet(A, matdGet(A, k, col) - s, k, col);
+            for(int row = k + 1; row < rows; row++)
+            {
+                matdSet(A, matdGet(A, row, col) - s * matdGet(A, row, k), row, col);
+            }
+        }
+    }
+}
+
+// copies X into the arena and factors it, QR.arr is NULL if the arena is exhausted
+QRD_T matdQRCompact(ARENA_T* arena, MATRIXD_T* X)
+{
+    QRD_T qr;
+    int steps = (X->rows - 1 < X->cols) ? X->rows - 1 : X->cols;
+
+    qr.QR = matdAlloc(arena, X->rows, X->cols);
+    qr.tau = arenaAlloc(arena, sizeof(float) * (steps > 0 ? steps : 1));
+    qr.steps = 0;
+
+    if(!qr.QR.arr || !qr.tau)
+    {
+        qr.QR.arr = NULL;
+        return qr;
+    }
+
+    matdCopyInto(&(qr.QR), X);
+    matdQRCompactInPlace(&qr);
+
+    return qr;
+}
+
+// B = Q^T * B, reflectors applied in order without forming Q
+void matdQTMulInPlace(QRD_T* qr, MATRIXD_T* B)
+{
+    MATRIXD_T* A = &(qr->QR);
+
+    for(int k = 0; k < qr->steps; k++)
+    {
+        if(qr->tau[k] == 0){continue;}
+
+        for(int col = 0; col < B->cols; col++)
+        {
+            float s = matdGet(B, k, col);
+            for(int row = k + 1; row < B->rows; row++)
+            {
+                s += matdGet(A, row, k) * matdGet(B, row, col);
+            }
+            s *= qr->tau[k];
+
+            matdSet(B, matdGet(B, k, col) - s, k, col);
+            for(int row = k + 1; row < B->rows; row++)
+            {
+                matdSet(B, matdGet(B, row, col) - s * matdGet(A, row, k), row, col);
+            }
+        }
+    }
+}
+
+// explicit rows x rows Q = H_0 * H_1 * ... * I, applied back to front
+void matdQFromCompactInto(MATRIXD_T* Q, QRD_T* qr)
+{
+    MATRIXD_T* A = &(qr->QR);
+    int n = A->rows;
+
+    memset(Q->arr, 0, sizeof(float) * n * n);
+    for(int iter = 0; iter < n; iter++)
+    {
+        matdSet(Q, 1, iter, iter);
+    }
+
+    for(int k = qr->steps - 1; k >= 0; k--)
+    {
+        if(qr->tau[k] == 0){continue;}
+
+        for(int col = k; col < n; col++)
+        {
+            float s = matdGet(Q, k, col);
+            for(int row = k + 1; row < n; row++)
+            {
+                s += matdGet(A, row, k) * matdGet(Q, row, col);
+            }
+            s *= qr->tau[k];
+
+            matdSet(Q, matdGet(Q, k, col) - s, k, col);
+            for(int row = k + 1; row < n; row++)
+            {
+                matdSet(Q, matdGet(Q, row, col) - s * matdGet(A, row, k), row, col);
+            }
+        }
+    }
+}
+
+// upper triangular backsubstitution R*X = B
+// only the top R->cols rows of R and B are used, so a tall R from a least
+// squares QR works as well
+void matdRBSInto(MATRIXD_T* X, MATRIXD_T* R, MATRIXD_T* B)
+{
+    for(int colB = 0; colB < B->cols; colB++)
+    {
+        for(int rowR = R->cols - 1; rowR >= 0; rowR--)
+        {
+            float num = matdGet(B, rowR, colB);
+
+            for(int iter = rowR + 1; iter < R->cols; iter++)
+            {
+                num -= matdGet(R, rowR, iter) * matdGet(X, iter, colB);
+            }
+
+            matdSet(X, num / matdGet(R, rowR, rowR), rowR, colB);
+        }
+    }
+}
+
+// A * X = B, least squares if A is tall. the factorization and Q^T*B live in
+// the arena only for the duration of the call. returns 1 if it ran out of space
+int matdSolveInto(ARENA_T* arena, MATRIXD_T* X, MATRIXD_T* A, MATRIXD_T* B)
+{
+    size_t mark = arenaMark(arena);
+
+    QRD_T qr = matdQRCompact(arena, A);
+    MATRIXD_T QTB = matdAlloc(arena, B->rows, B->cols);
+
+    if(!qr.QR.arr || !QTB.arr)
+    {
+        arenaRelease(arena, mark);
+        return 1;
+    }
+
+    matdCopyInto(&QTB, B);
+    matdQTMulInPlace(&qr, &QTB);
+    matdRBSInto(X, &(qr.QR), &QTB);
+
+    arenaRelease(arena, mark);
+    return 0;
+}
+
+// cholesky A = L L^T for symmetric positive definite A, only the lower
+// triangle of A is read. returns 1 if A is not positive definite
+int matdCholeskyInto(MATRIXD_T* L, MATRIXD_T* A)
+{
+    int n = A->rows;
+
+    memset(L->arr, 0, sizeof(float) * n * n);
+
+    for(int col = 0; col < n; col++)
+    {
+        float d = matdGet(A, col, col);
+        for(int iter = 0; iter < col; iter++)
+        {
+            d -= matdGet(L, col, iter) * matdGet(L, col, iter);
+        }
+        if(!(d > 0)){return 1;}
+
+        d = sqrtf(d);
+        matdSet(L, d, col, col);
+
+        for(int row = col + 1; row < n; row++)
+        {
+            float l = matdGet(A, row, col);
+            for(int iter = 0; iter < col; iter++)
+            {
+                l -= matdGet(L, row, iter) * matdGet(L, col, iter);
+            }
+            matdSet(L, l / d, row, col);
+        }
+    }
+
+    return 0;
+}
+
+// L L^T X = B, forward then back substitution
+void matdCholeskySolveInto(MATRIXD_T* X, MATRIXD_T* L, MATRIXD_T* B)
+{
+    int n = L->rows;
+
+    for(int col = 0; col < B->cols; col++)
+    {
+        for(int row = 0; row < n; row++)
+        {
+            float num = matdGet(B, row, col);
+            for(int iter = 0; iter < row; iter++)
+            {
+                num -= matdGet(L, row, iter) * matdGet(X, iter, col);
+            }
+            matdSet(X, num / matdGet(L, row, row), row, col);
+        }
+        for(int row = n - 1; row >= 0; row--)
+        {
+            float num = matdGet(X, row, col);
+            for(int iter = row + 1; iter < n; iter++)
+            {
+                num -= matdGet(L, iter, row) * matdGet(X, iter, col);
+            }
+            matdSet(X, num / matdGet(L, row, row), row, col);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef LINALG_DYN_H
+#define LINALG_DYN_H
+
+#include "arena.h"
+
+// Dynamically sized matrices, same row major layout as MATRIX_T.
+// The storage is not owned by the matrix, it comes from an arena (matdAlloc)
+// or is a view on existing memory, e.g. a MATRIX_T. Outputs must already have
+// the right shape, the functions never allocate unless they take an arena.
+// The MATRIX_T QR/solve/cholesky functions run on these kernels through views.
+
+typedef struct{
+    float* arr;
+    int rows;
+    int cols;
+} MATRIXD_T;
+
+typedef struct{
+    // compact householder QR, see QR_COMPACT_T in linalg.h
+    MATRIXD_T QR;
+    float* tau;
+    int steps;
+} QRD_T;
+
+
+MATRIXD_T matdAlloc(ARENA_T* , int , int );
+MATRIXD_T matdZeros(ARENA_T* , int , int );
+MATRIXD_T matdEye(ARENA_T* , int );
+void matdCopyInto(MATRIXD_T* , MATRIXD_T* );
+void matdAddInto(MATRIXD_T* , MATRIXD_T* , MATRIXD_T* );
+void matdSubInto(MATRIXD_T* , MATRIXD_T* , MATRIXD_T* );
+void matdTimesScalarInto(MATRIXD_T* , MATRIXD_T* , float );
+void matdTransposeInto(MATRIXD_T* , MATRIXD_T* );
+void matdMulKernel(MATRIXD_T* , MATRIXD_T* , MATRIXD_T* , int , int , int );
+void matdMulInto(MATRIXD_T* , MATRIXD_T* , MATRIXD_T* );
+void matdMulAddInto(MATRIXD_T* , MATRIXD_T* , MATRIXD_T* );
+void matdMulTransBInto(MATRIXD_T* , MATRIXD_T* , MATRIXD_T* );
+void matdMulTransBAddInto(MATRIXD_T* , MATRIXD_T* , MATRIXD_T* );
+void matdMulTransAInto(MATRIXD_T* , MATRIXD_T* , MATRIXD_T* );
+void matdQRCompactInPlace(QRD_T* );
+QRD_T matdQRCompact(ARENA_T* , MATRIXD_T* );
+void matdQTMulInPlace(QRD_T* , MATRIXD_T* );
+void matdQFromCompactInto(MATRIXD_T* , QRD_T* );
+void matdRBSInto(MATRIXD_T* , MATRIXD_T* , MATRIXD_T* );
+int  matdSolveInto(ARENA_T* , MATRIXD_T* , MATRIXD_T* , MATRIXD_T* );
+int  matdCholeskyInto(MATRIXD_T* , MATRIXD_T* );
+void matdCholeskySolveInto(MATRIXD_T* , MATRIXD_T* , MATRIXD_T* );
+
+
+static inline void matdSet(MATRIXD_T* A, float value, int row, int col)
+{
+    A->arr[row * A->cols + col] = value;
+}
+static inline float matdGet(MATRIXD_T* A, int row, int col)
+{
+    return A->arr[row * A->cols + col];
+}
+
+#endif
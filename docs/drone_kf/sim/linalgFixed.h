@@ -0,0 +1,456 @@
+#ifndef LINALG_FIXED_H
+#define LINALG_FIXED_H
+
+#include <math.h>
+#include "linalgSimd.h"
+
+// Fixed size matrices for the kalman filter.
+// Same row major layout as MATRIX_T, but the dimensions are part of the type,
+// so storage is exactly rows*cols floats and all loops have constant bounds.
+// The kernels below are only ever called with literal dimensions from the
+// generated wrappers, so after inlining the compiler unrolls them completely.
+
+#define LINALG_FIXED_MAX 5 // largest dimension used with fixedSolve and the transposed fixedMul
+
+
+// generic kernels ----------
+
+// X = A^T, A is rA x cA
+static inline void fixedTranspose(float* X, const float* A, const int rA, const int cA)
+{
+    for(int row = 0; row < rA; row++)
+    {
+        for(int col = 0; col < cA; col++)
+        {
+            X[col * rA + row] = A[row * cA + col];
+        }
+    }
+}
+
+// X (+)= A * op(B), A is rA x cA, op(B) is cA x cB
+// with transB set B is stored as cB x cA and read transposed
+// X must not alias A or B
+static inline void fixedMul(float* X, const float* A, const float* B, const int rA, const int cA, const int cB, const int transB, const int accumulate)
+{
+#if LINALG_SIMD
+    // rows of 4 or more go through the vector kernel, a transposed B is
+    // flipped into a local buffer first so its rows are contiguous
+    if(cB >= 4)
+    {
+        float BT[LINALG_FIXED_MAX * LINALG_FIXED_MAX];
+        if(transB)
+        {
+            fixedTranspose(BT, B, cB, cA);
+            B = BT;
+        }
+        for(int row = 0; row < rA; row++)
+        {
+            simdMulRow(X + row * cB, A + row * cA, 1, B, cA, cB, accumulate);
+        }
+        return;
+    }
+#endif
+
+    for(int row = 0; row < rA; row++)
+    {
+        for(int col = 0; col < cB; col++)
+        {
+            float sum = 0;
+            for(int iter = 0; iter < cA; iter++)
+            {
+                sum += A[row * cA + iter] * (transB ? B[col * cA + iter] : B[iter * cB + col]);
+            }
+            X[row * cB + col] = accumulate ? X[row * cB + col] + sum : sum;
+        }
+    }
+}
+
+// X = A + B
+static inline void fixedAdd(float* X, const float* A, const float* B, const int n)
+{
+#if LINALG_SIMD
+    if(n >= 4){simdAdd(X, A, B, n); return;}
+#endif
+    for(int iter = 0; iter < n; iter++)
+    {
+        X[iter] = A[iter] + B[iter];
+    }
+}
+
+// X = A - B
+static inline void fixedSub(float* X, const float* A, const float* B, const int n)
+{
+#if LINALG_SIMD
+    if(n >= 4){simdSub(X, A, B, n); return;}
+#endif
+    for(int iter = 0; iter < n; iter++)
+    {
+        X[iter] = A[iter] - B[iter];
+    }
+}
+
+// A * X = B, A is n x n, B is n x cB
+// with right set it solves X * A = B instead, B and X are then cB x n
+// householder QR, the reflectors are applied directly to A and B, Q is never formed
+static inline void fixedSolve(float* X, const float* A, const float* B, const int n, const int cB, const int right)
+{
+    float R[LINALG_FIXED_MAX * LINALG_FIXED_MAX];
+    float QTB[LINALG_FIXED_MAX * LINALG_FIXED_MAX];
+    float v[LINALG_FIXED_MAX];
+
+    // X * A = B is A^T * X^T = B^T, transpose while loading
+    for(int row = 0; row < n; row++)
+    {
+        for(int col = 0; col < n; col++){R[row * n + col] = right ? A[col * n + row] : A[row * n + col];}
+        for(int col = 0; col < cB; col++){QTB[row * cB + col] = right ? B[col * n + row] : B[row * cB + col];}
+    }
+
+    for(int k = 0; k < n - 1; k++)
+    {
+        float norm = 0;
+        for(int row = k; row < n; row++)
+        {
+            norm += R[row * n + k] * R[row * n + k];
+        }
+        norm = sqrtf(norm);
+
+        // v = x - alpha*e_k, sign of alpha chosen to avoid cancellation
+        float alpha = (R[k * n + k] > 0) ? -norm : norm;
+        float vTv = 0;
+        for(int row = k; row < n; row++)
+        {
+            v[row] = R[row * n + k];
+        }
+        v[k] -= alpha;
+        for(int row = k; row < n; row++)
+        {
+            vTv += v[row] * v[row];
+        }
+        if(vTv == 0){continue;}
+
+        // H = I - 2 v v^T / v^T v applied to the remaining columns
+        for(int col = k; col < n; col++)
+        {
+            float s = 0;
+            for(int row = k; row < n; row++){s += v[row] * R[row * n + col];}
+            s = 2 * s / vTv;
+            for(int row = k; row < n; row++){R[row * n + col] -= s * v[row];}
+        }
+        for(int col = 0; col < cB; col++)
+        {
+            float s = 0;
+            for(int row = k; row < n; row++){s += v[row] * QTB[row * cB + col];}
+            s = 2 * s / vTv;
+            for(int row = k; row < n; row++){QTB[row * cB + col] -= s * v[row];}
+        }
+    }
+
+    // upper triangular backsubstitution R*X = Q^T*B
+    for(int col = 0; col < cB; col++)
+    {
+        for(int row = n - 1; row >= 0; row--)
+        {
+            float num = QTB[row * cB + col];
+            for(int iter = row + 1; iter < n; iter++)
+            {
+                num -= R[row * n + iter] * (right ? X[col * n + iter] : X[iter * cB + col]);
+            }
+            if(right)
+            {
+                X[col * n + row] = num / R[row * n + row];
+            }
+            else
+            {
+                X[row * cB + col] = num / R[row * n + row];
+            }
+        }
+    }
+}
+
+
+// packed symmetric matrices ----------
+// only the upper triangle is stored, row by row:
+// [a b c
+//  b d e   is stored as [a b c d e f]
+//  c e f]
+// so symmetry is exact and a 5x5 covariance takes 15 floats
+
+static inline int fixedSymIdx(int row, int col, const int n)
+{
+    if(row > col)
+    {
+        int tmp = row;
+        row = col;
+        col = tmp;
+    }
+    return row * n - (row * (row - 1)) / 2 + (col - row);
+}
+
+// X = P as a dense n x n row major matrix. the packed offset of the diagonal
+// entry is carried from row to row instead of going through fixedSymIdx
+static inline void fixedSymExpand(float* X, const float* P, const int n)
+{
+    int offset = 0;
+    for(int row = 0; row < n; row++)
+    {
+        for(int col = row; col < n; col++)
+        {
+            X[row * n + col] = P[offset + col - row];
+            X[col * n + row] = P[offset + col - row];
+        }
+        offset += n - row;
+    }
+}
+
+// X (+)= A * P * A^T, A is r x n, P packed n x n, X packed r x r
+// A * P runs through fixedMul on the expanded P, then only the unique
+// entries of the result are computed
+static inline void fixedSymTriple(float* X, const float* A, const float* P, const int r, const int n, const int accumulate)
+{
+    float Pd[LINALG_FIXED_MAX * LINALG_FIXED_MAX];
+    float AP[LINALG_FIXED_MAX * LINALG_FIXED_MAX];
+
+    fixedSymExpand(Pd, P, n);
+    fixedMul(AP, A, Pd, r, n, n, 0, 0);
+
+    int idx = 0;
+    for(int row = 0; row < r; row++)
+    {
+        for(int col = row; col < r; col++)
+        {
+            float sum = 0;
+            for(int iter = 0; iter < n; iter++)
+            {
+                sum += AP[row * n + iter] * A[col * n + iter];
+            }
+            X[idx] = accumulate ? X[idx] + sum : sum;
+            idx++;
+        }
+    }
+}
+
+// X = P * B^T, P packed n x n, B is c x n, X is n x c
+static inline void fixedSymMulT(float* X, const float* P, const float* B, const int n, const int c)
+{
+    float Pd[LINALG_FIXED_MAX * LINALG_FIXED_MAX];
+
+    fixedSymExpand(Pd, P, n);
+    fixedMul(X, Pd, B, n, n, c, 1, 0);
+}
+
+
+// A * X = B for symmetric positive definite A, A = L D L^T
+// A is packed (see fixedSymIdx), right works as in fixedSolve.
+// no square roots, returns 1 without touching X if a pivot is not positive
+static inline int fixedSolveSPD(float* X, const float* A, const float* B, const int n, const int cB, const int right)
+{
+    float L[LINALG_FIXED_MAX * LINALG_FIXED_MAX];
+    float D[LINALG_FIXED_MAX];
+    float Y[LINALG_FIXED_MAX];
+
+    for(int col = 0; col < n; col++)
+    {
+        float d = A[fixedSymIdx(col, col, n)];
+        for(int iter = 0; iter < col; iter++)
+        {
+            d -= L[col * n + iter] * L[col * n + iter] * D[iter];
+        }
+        if(!(d > 0)){return 1;}
+        D[col] = d;
+
+        for(int row = col + 1; row < n; row++)
+        {
+            float l = A[fixedSymIdx(row, col, n)];
+            for(int iter = 0; iter < col; iter++)
+            {
+                l -= L[row * n + iter] * L[col * n + iter] * D[iter];
+            }
+            L[row * n + col] = l / d;
+        }
+    }
+
+    for(int col = 0; col < cB; col++)
+    {
+        // L y = b, then D
+        for(int row = 0; row < n; row++)
+        {
+            float num = right ? B[col * n + row] : B[row * cB + col];
+            for(int iter = 0; iter < row; iter++)
+            {
+                num -= L[row * n + iter] * Y[iter];
+            }
+            Y[row] = num;
+        }
+        for(int row = 0; row < n; row++)
+        {
+            Y[row] /= D[row];
+        }
+
+        // L^T x = y
+        for(int row = n - 1; row >= 0; row--)
+        {
+            float num = Y[row];
+            for(int iter = row + 1; iter < n; iter++)
+            {
+                num -= L[iter * n + row] * Y[iter];
+            }
+            Y[row] = num;
+
+            if(right)
+            {
+                X[col * n + row] = num;
+            }
+            else
+            {
+                X[row * cB + col] = num;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+// per shape generators ----------
+
+#define MAT_FIXED_TYPE(r, c) \
+    typedef struct{ float arr[(r) * (c)]; } MAT##r##X##c##_T; \
+    static inline void mat##r##x##c##Set(MAT##r##X##c##_T* A, float value, int row, int col) \
+    { A->arr[row * (c) + col] = value; } \
+    static inline float mat##r##x##c##Get(MAT##r##X##c##_T* A, int row, int col) \
+    { return A->arr[row * (c) + col]; } \
+    static inline MAT##r##X##c##_T mat##r##x##c##Zeros(void) \
+    { MAT##r##X##c##_T X = {{0}}; return X; }
+
+#define MAT_FIXED_EYE(n) \
+    static inline MAT##n##X##n##_T mat##n##x##n##Eye(void) \
+    { MAT##n##X##n##_T X = {{0}}; for(int iter = 0; iter < (n); iter++){X.arr[iter * (n) + iter] = 1;} return X; }
+
+#define MAT_FIXED_ADDSUB(r, c) \
+    static inline void mat##r##x##c##AddInto(MAT##r##X##c##_T* X, MAT##r##X##c##_T* A, MAT##r##X##c##_T* B) \
+    { fixedAdd(X->arr, A->arr, B->arr, (r) * (c)); } \
+    static inline void mat##r##x##c##SubInto(MAT##r##X##c##_T* X, MAT##r##X##c##_T* A, MAT##r##X##c##_T* B) \
+    { fixedSub(X->arr, A->arr, B->arr, (r) * (c)); } \
+    static inline MAT##r##X##c##_T mat##r##x##c##Add(MAT##r##X##c##_T* A, MAT##r##X##c##_T* B) \
+    { MAT##r##X##c##_T X; mat##r##x##c##AddInto(&X, A, B); return X; } \
+    static inline MAT##r##X##c##_T mat##r##x##c##Sub(MAT##r##X##c##_T* A, MAT##r##X##c##_T* B) \
+    { MAT##r##X##c##_T X; mat##r##x##c##SubInto(&X, A, B); return X; }
+
+#define MAT_FIXED_TRANSPOSE(r, c) \
+    static inline void mat##r##x##c##TransposeInto(MAT##c##X##r##_T* X, MAT##r##X##c##_T* A) \
+    { fixedTranspose(X->arr, A->arr, (r), (c)); } \
+    static inline MAT##c##X##r##_T mat##r##x##c##Transpose(MAT##r##X##c##_T* A) \
+    { MAT##c##X##r##_T X; mat##r##x##c##TransposeInto(&X, A); return X; }
+
+// (r x k) * (k x c)
+#define MAT_FIXED_MUL(r, k, c) \
+    static inline void mat##r##x##k##Mul##k##x##c##Into(MAT##r##X##c##_T* X, MAT##r##X##k##_T* A, MAT##k##X##c##_T* B) \
+    { fixedMul(X->arr, A->arr, B->arr, (r), (k), (c), 0, 0); } \
+    static inline void mat##r##x##k##Mul##k##x##c##AddInto(MAT##r##X##c##_T* X, MAT##r##X##k##_T* A, MAT##k##X##c##_T* B) \
+    { fixedMul(X->arr, A->arr, B->arr, (r), (k), (c), 0, 1); } \
+    static inline MAT##r##X##c##_T mat##r##x##k##Mul##k##x##c(MAT##r##X##k##_T* A, MAT##k##X##c##_T* B) \
+    { MAT##r##X##c##_T X; mat##r##x##k##Mul##k##x##c##Into(&X, A, B); return X; }
+
+// (r x k) * (c x k)^T, B is never transposed in memory
+#define MAT_FIXED_MULT(r, k, c) \
+    static inline void mat##r##x##k##MulT##c##x##k##Into(MAT##r##X##c##_T* X, MAT##r##X##k##_T* A, MAT##c##X##k##_T* B) \
+    { fixedMul(X->arr, A->arr, B->arr, (r), (k), (c), 1, 0); } \
+    static inline void mat##r##x##k##MulT##c##x##k##AddInto(MAT##r##X##c##_T* X, MAT##r##X##k##_T* A, MAT##c##X##k##_T* B) \
+    { fixedMul(X->arr, A->arr, B->arr, (r), (k), (c), 1, 1); }
+
+// (n x n) * X = (n x c)
+#define MAT_FIXED_SOLVE(n, c) \
+    static inline void mat##n##x##n##Solve##n##x##c##Into(MAT##n##X##c##_T* X, MAT##n##X##n##_T* A, MAT##n##X##c##_T* B) \
+    { fixedSolve(X->arr, A->arr, B->arr, (n), (c), 0); } \
+    static inline MAT##n##X##c##_T mat##n##x##n##Solve##n##x##c(MAT##n##X##n##_T* A, MAT##n##X##c##_T* B) \
+    { MAT##n##X##c##_T X; mat##n##x##n##Solve##n##x##c##Into(&X, A, B); return X; }
+
+// X * (n x n) = (r x n)
+#define MAT_FIXED_SOLVE_RIGHT(n, r) \
+    static inline void mat##n##x##n##SolveRight##r##x##n##Into(MAT##r##X##n##_T* X, MAT##n##X##n##_T* A, MAT##r##X##n##_T* B) \
+    { fixedSolve(X->arr, A->arr, B->arr, (n), (r), 1); }
+
+// packed symmetric n x n
+#define MAT_FIXED_SYM(n) \
+    typedef struct{ float arr[(n) * ((n) + 1) / 2]; } SYM##n##_T; \
+    static inline void sym##n##Set(SYM##n##_T* A, float value, int row, int col) \
+    { A->arr[fixedSymIdx(row, col, (n))] = value; } \
+    static inline float sym##n##Get(SYM##n##_T* A, int row, int col) \
+    { return A->arr[fixedSymIdx(row, col, (n))]; } \
+    static inline SYM##n##_T sym##n##Zeros(void) \
+    { SYM##n##_T X = {{0}}; return X; } \
+    static inline void sym##n##ToFullInto(MAT##n##X##n##_T* X, SYM##n##_T* A) \
+    { for(int row = 0; row < (n); row++){for(int col = 0; col < (n); col++){X->arr[row * (n) + col] = A->arr[fixedSymIdx(row, col, (n))];}} }
+
+// (r x n) * sym(n) * (r x n)^T, upper triangle only
+#define MAT_FIXED_SYM_TRIPLE(r, n) \
+    static inline void sym##n##Triple##r##x##n##Into(SYM##r##_T* X, MAT##r##X##n##_T* A, SYM##n##_T* P) \
+    { fixedSymTriple(X->arr, A->arr, P->arr, (r), (n), 0); } \
+    static inline void sym##n##Triple##r##x##n##AddInto(SYM##r##_T* X, MAT##r##X##n##_T* A, SYM##n##_T* P) \
+    { fixedSymTriple(X->arr, A->arr, P->arr, (r), (n), 1); }
+
+// sym(n) * (c x n)^T
+#define MAT_FIXED_SYM_MULT(n, c) \
+    static inline void sym##n##MulT##c##x##n##Into(MAT##n##X##c##_T* X, SYM##n##_T* P, MAT##c##X##n##_T* B) \
+    { fixedSymMulT(X->arr, P->arr, B->arr, (n), (c)); }
+
+// X * sym(n) = (r x n) for positive definite A, returns 1 if A is not
+#define MAT_FIXED_SOLVE_SPD_RIGHT(n, r) \
+    static inline int sym##n##SolveRight##r##x##n##Into(MAT##r##X##n##_T* X, SYM##n##_T* A, MAT##r##X##n##_T* B) \
+    { return fixedSolveSPD(X->arr, A->arr, B->arr, (n), (r), 1); }
+
+
+// shapes used by the kalman filter (5 states, 2 inputs, 4 measurements) ----------
+
+MAT_FIXED_TYPE(2, 1)
+MAT_FIXED_TYPE(2, 2)
+MAT_FIXED_TYPE(4, 1)
+MAT_FIXED_TYPE(4, 4)
+MAT_FIXED_TYPE(4, 5)
+MAT_FIXED_TYPE(5, 1)
+MAT_FIXED_TYPE(5, 2)
+MAT_FIXED_TYPE(5, 4)
+MAT_FIXED_TYPE(5, 5)
+
+MAT_FIXED_SYM(4)
+MAT_FIXED_SYM(5)
+
+MAT_FIXED_EYE(5)
+
+MAT_FIXED_ADDSUB(4, 1)
+MAT_FIXED_ADDSUB(4, 4)
+MAT_FIXED_ADDSUB(5, 1)
+MAT_FIXED_ADDSUB(5, 5)
+
+MAT_FIXED_TRANSPOSE(4, 4)
+MAT_FIXED_TRANSPOSE(4, 5)
+MAT_FIXED_TRANSPOSE(5, 4)
+MAT_FIXED_TRANSPOSE(5, 5)
+
+MAT_FIXED_MUL(2, 2, 1)
+MAT_FIXED_MUL(4, 5, 1)
+MAT_FIXED_MUL(4, 5, 4)
+MAT_FIXED_MUL(5, 2, 1)
+MAT_FIXED_MUL(5, 4, 1)
+MAT_FIXED_MUL(5, 4, 4)
+MAT_FIXED_MUL(5, 4, 5)
+MAT_FIXED_MUL(5, 5, 1)
+MAT_FIXED_MUL(5, 5, 4)
+MAT_FIXED_MUL(5, 5, 5)
+
+MAT_FIXED_MULT(5, 4, 5)
+MAT_FIXED_MULT(5, 5, 4)
+MAT_FIXED_MULT(5, 5, 5)
+
+MAT_FIXED_SOLVE(4, 5)
+MAT_FIXED_SOLVE_RIGHT(4, 5)
+MAT_FIXED_SOLVE_SPD_RIGHT(4, 5)
+
+MAT_FIXED_SYM_TRIPLE(4, 5)
+MAT_FIXED_SYM_TRIPLE(5, 4)
+MAT_FIXED_SYM_TRIPLE(5, 5)
+
+MAT_FIXED_SYM_MULT(5, 4)
+
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef LINALG_SIMD_H
+#define LINALG_SIMD_H
+
+// 4 wide float vectors for the matrix kernels.
+// wasm simd128 for the emcc build (-msimd128), SSE for a native x86 build,
+// nothing otherwise. Define LINALG_NO_SIMD to force the scalar loops.
+// The rows in the filter are 4 or 5 wide, so one vector plus a scalar tail
+// covers them; AVX builds use the same 4 wide path.
+// The vector kernels do the same float operations in the same order as the
+// scalar loops, so as long as nothing is contracted to fma (-ffp-contract=off
+// natively, simd128 has no fma) both paths give the same bits. make check
+// holds the two builds to LINALG_SIMD_ULP.
+
+#define LINALG_SIMD_ULP 0 // largest difference, in ulp, between the SIMD and scalar results
+
+#if !defined(LINALG_NO_SIMD) && defined(__wasm_simd128__)
+
+#include <wasm_simd128.h>
+#define LINALG_SIMD 1
+typedef v128_t SIMD4_T;
+static inline SIMD4_T simd4Load(const float* p)          { return wasm_v128_load(p); }
+static inline void    simd4Store(float* p, SIMD4_T v)    { wasm_v128_store(p, v); }
+static inline SIMD4_T simd4Splat(float s)                { return wasm_f32x4_splat(s); }
+static inline SIMD4_T simd4Add(SIMD4_T a, SIMD4_T b)     { return wasm_f32x4_add(a, b); }
+static inline SIMD4_T simd4Sub(SIMD4_T a, SIMD4_T b)     { return wasm_f32x4_sub(a, b); }
+static inline SIMD4_T simd4Mul(SIMD4_T a, SIMD4_T b)     { return wasm_f32x4_mul(a, b); }
+
+#elif !defined(LINALG_NO_SIMD) && (defined(__SSE__) || defined(_M_X64))
+
+#include <xmmintrin.h>
+#define LINALG_SIMD 1
+typedef __m128 SIMD4_T;
+static inline SIMD4_T simd4Load(const float* p)          { return _mm_loadu_ps(p); }
+static inline void    simd4Store(float* p, SIMD4_T v)    { _mm_storeu_ps(p, v); }
+static inline SIMD4_T simd4Splat(float s)                { return _mm_set1_ps(s); }
+static inline SIMD4_T simd4Add(SIMD4_T a, SIMD4_T b)     { return _mm_add_ps(a, b); }
+static inline SIMD4_T simd4Sub(SIMD4_T a, SIMD4_T b)     { return _mm_sub_ps(a, b); }
+static inline SIMD4_T simd4Mul(SIMD4_T a, SIMD4_T b)     { return _mm_mul_ps(a, b); }
+
+#else
+
+#define LINALG_SIMD 0
+
+#endif
+
+
+#if LINALG_SIMD
+
+// X = A + B, X = A - B, X = A * s over n floats
+static inline void simdAdd(float* X, const float* A, const float* B, int n)
+{
+    int iter = 0;
+    for(; iter + 4 <= n; iter += 4)
+    {
+        simd4Store(X + iter, simd4Add(simd4Load(A + iter), simd4Load(B + iter)));
+    }
+    for(; iter < n; iter++)
+    {
+        X[iter] = A[iter] + B[iter];
+    }
+}
+
+static inline void simdSub(float* X, const float* A, const float* B, int n)
+{
+    int iter = 0;
+    for(; iter + 4 <= n; iter += 4)
+    {
+        simd4Store(X + iter, simd4Sub(simd4Load(A + iter), simd4Load(B + iter)));
+    }
+    for(; iter < n; iter++)
+    {
+        X[iter] = A[iter] - B[iter];
+    }
+}
+
+static inline void simdScale(float* X, const float* A, float s, int n)
+{
+    SIMD4_T sv = simd4Splat(s);
+    int iter = 0;
+    for(; iter + 4 <= n; iter += 4)
+    {
+        simd4Store(X + iter, simd4Mul(simd4Load(A + iter), sv));
+    }
+    for(; iter < n; iter++)
+    {
+        X[iter] = A[iter] * s;
+    }
+}
+
+// one row of a row major product, Xrow (+)= sum_k a[k * aStride] * B[k, :]
+// B rows are walked contiguously, the columns go 4 at a time with a scalar tail
+static inline void simdMulRow(float* Xrow, const float* a, int aStride, const float* B, int inner, int cols, int accumulate)
+{
+    int col = 0;
+    for(; col + 4 <= cols; col += 4)
+    {
+        SIMD4_T sum = simd4Splat(0);
+        for(int iter = 0; iter < inner; iter++)
+        {
+            sum = simd4Add(sum, simd4Mul(simd4Splat(a[iter * aStride]), simd4Load(B + iter * cols + col)));
+        }
+        simd4Store(Xrow + col, accumulate ? simd4Add(simd4Load(Xrow + col), sum) : sum);
+    }
+    for(; col < cols; col++)
+    {
+        float sum = 0;
+        for(int iter = 0; iter < inner; iter++)
+        {
+            sum += a[iter * aStride] * B[iter * cols + col];
+        }
+        Xrow[col] = accumulate ? Xrow[col] + sum : sum;
+    }
+}
+
+#endif
+
+
+#endif
@@ -0,0 +1,92 @@
+#include "measurementQueue.h"
+
+void measurementQueueInit(MEASUREMENT_QUEUE_T* queue)
+{
+    queue->count = 0;
+    queue->dropped = 0;
+}
+
+static int measurementBefore(MEASUREMENT_T* a, MEASUREMENT_T* b)
+{
+    if(a->arrival != b->arrival)
+    {
+        return a->arrival < b->arrival;
+    }
+    return a->stamp < b->stamp;
+}
+
+// returns 1 and drops the sample if the queue is full
+int measurementQueuePush(MEASUREMENT_QUEUE_T* queue, MEASUREMENT_T* measurement)
+{
+    if(queue->count >= MEASUREMENT_QUEUE_CAPACITY)
+    {
+        queue->dropped++;
+        return 1;
+    }
+
+    // sift up
+    int iter = queue->count++;
+    while(iter > 0)
+    {
+        int parent = (iter - 1) / 2;
+        if(!measurementBefore(measurement, &(queue->items[parent]))){break;}
+
+        queue->items[iter] = queue->items[parent];
+        iter = parent;
+    }
+    queue->items[iter] = *measurement;
+
+    return 0;
+}
+
+// pops the earliest measurement that has arrived by step now,
+// returns 0 if there is none
+int measurementQueuePop(MEASUREMENT_QUEUE_T* queue, unsigned int now, MEASUREMENT_T* out)
+{
+    if(queue->count == 0 || queue->items[0].arrival > now)
+    {
+        return 0;
+    }
+
+    *out = queue->items[0];
+
+    // sift the last item down from the root
+    MEASUREMENT_T last = queue->items[--queue->count];
+    int iter = 0;
+    while(1)
+    {
+        int child = 2 * iter + 1;
+        if(child >= queue->count){break;}
+        if(child + 1 < queue->count && measurementBefore(&(queue->items[child + 1]), &(queue->items[child]))){child++;}
+        if(!measurementBefore(&(queue->items[child]), &last)){break;}
+
+        queue->items[iter] = queue->items[child];
+        iter = child;
+    }
+    queue->items[iter] = last;
+
+    return 1;
+}
+
+// rate in Hz and latency in seconds, rounded to whole steps of dt.
+// the first sample is one period after step 0
+void sensorRateSet(SENSOR_RATE_T* sensor, float rate, float latency, float dt)
+{
+    sensor->period = (rate > 0) ? (unsigned int)(1.0f / (rate * dt) + 0.5f) : 0;
+    if(rate > 0 && sensor->period == 0){sensor->period = 1;}
+
+    sensor->latency = (unsigned int)(latency / dt + 0.5f);
+    sensor->next = sensor->period;
+}
+
+// 1 if the sensor samples at this step, then schedules the next sample
+int sensorRateDue(SENSOR_RATE_T* sensor, unsigned int step)
+{
+    if(sensor->period == 0 || step < sensor->next)
+    {
+        return 0;
+    }
+
+    sensor->next += sensor->period;
+    return 1;
+}
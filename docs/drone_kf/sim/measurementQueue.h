@@ -0,0 +1,39 @@
+#ifndef MEASUREMENT_QUEUE_H
+#define MEASUREMENT_QUEUE_H
+
+// sensor scheduling on the sim step clock. every sensor has a sample period
+// and a latency (both in steps), a sample is pushed with the step it was taken
+// and the step it arrives, and is popped once the clock reaches its arrival.
+// times are step counts rather than float seconds so they never drift.
+
+#define MEASUREMENT_QUEUE_CAPACITY 32
+#define MEASUREMENT_VALUES 2
+
+typedef struct{
+    unsigned int stamp;   // step the sample was taken
+    unsigned int arrival; // step it is available to the estimator
+    int sensor;           // SENSOR_* id
+    float value[MEASUREMENT_VALUES];
+} MEASUREMENT_T;
+
+// binary min heap on (arrival, stamp), fixed storage
+typedef struct{
+    MEASUREMENT_T items[MEASUREMENT_QUEUE_CAPACITY];
+    int count;
+    unsigned int dropped; // pushes rejected because the queue was full
+} MEASUREMENT_QUEUE_T;
+
+typedef struct{
+    unsigned int period;  // steps between samples, 0 disables the sensor
+    unsigned int latency; // steps from sample to arrival
+    unsigned int next;    // step of the next sample
+} SENSOR_RATE_T;
+
+void measurementQueueInit(MEASUREMENT_QUEUE_T* );
+int  measurementQueuePush(MEASUREMENT_QUEUE_T* , MEASUREMENT_T* );
+int  measurementQueuePop(MEASUREMENT_QUEUE_T* , unsigned int , MEASUREMENT_T* );
+
+void sensorRateSet(SENSOR_RATE_T* , float , float , float );
+int  sensorRateDue(SENSOR_RATE_T* , unsigned int );
+
+#endif
@@ -0,0 +1,124 @@
+#include "rng.h"
+#include "fastMath.h"
+
+#define RNG_PHILOX_M0 0xD2511F53u
+#define RNG_PHILOX_M1 0xCD9E8D57u
+#define RNG_PHILOX_W0 0x9E3779B9u
+#define RNG_PHILOX_W1 0xBB67AE85u
+#define RNG_PHILOX_ROUNDS 10
+
+#define RNG_2PI 6.28318530717958648f
+
+
+void rngStreamInit(RNG_STREAM_T* stream, uint32_t seed, uint32_t entity)
+{
+    stream->key[0] = seed;
+    stream->key[1] = entity;
+}
+
+// out = philox4x32-10(counter, key)
+void rngPhilox(const uint32_t* counter, const uint32_t* key, uint32_t* out)
+{
+    uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+    uint32_t k0 = key[0], k1 = key[1];
+
+    for(int round = 0; round < RNG_PHILOX_ROUNDS; round++)
+    {
+        uint64_t p0 = (uint64_t)RNG_PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t)RNG_PHILOX_M1 * c2;
+
+        c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        c1 = (uint32_t)p1;
+        c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c3 = (uint32_t)p0;
+
+        k0 += RNG_PHILOX_W0;
+        k1 += RNG_PHILOX_W1;
+    }
+
+    out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+static inline void rngPair(RNG_STREAM_T* stream, unsigned int sensor, unsigned int step, float* radius, float* angle)
+{
+    uint32_t counter[4] = {step, sensor, 0, 0};
+    uint32_t bits[4];
+    rngPhilox(counter, stream->key, bits);
+
+    *radius = fastSqrt(-2.0f * fastLog(rngUniform(bits[0])));
+    *angle = RNG_2PI * rngUniform(bits[1]);
+}
+
+// two standard normals of (sensor, step), z[0] = r cos(a), z[1] = r sin(a)
+void rngNormal2(RNG_STREAM_T* stream, unsigned int sensor, unsigned int step, float* z)
+{
+    float radius, angle, s, c;
+    rngPair(stream, sensor, step, &radius, &angle);
+    fastSinCos(angle, &s, &c);
+
+    z[0] = radius * c;
+    z[1] = radius * s;
+}
+
+// the pairs of count steps step, step + stride, ..., z[2 * iter] and
+// z[2 * iter + 1] are rngNormal2 of step + iter * stride. the sincos runs four
+// steps at a time, fastSinCos4 matches fastSinCos so the result is the same.
+void rngNormal2Fill(RNG_STREAM_T* stream, unsigned int sensor, unsigned int step, unsigned int stride, int count, float* z)
+{
+    int iter = 0;
+    for(; iter + 4 <= count; iter += 4)
+    {
+        float radius[4], angle[4], s[4], c[4];
+        for(int lane = 0; lane < 4; lane++)
+        {
+            rngPair(stream, sensor, step + (iter + lane) * stride, &radius[lane], &angle[lane]);
+        }
+
+        fastSinCos4(angle, s, c);
+
+        for(int lane = 0; lane < 4; lane++)
+        {
+            z[2 * (iter + lane)]     = radius[lane] * c[lane];
+            z[2 * (iter + lane) + 1] = radius[lane] * s[lane];
+        }
+    }
+    for(; iter < count; iter++)
+    {
+        rngNormal2(stream, sensor, step + iter * stride, z + 2 * iter);
+    }
+}
+
+
+// NOISE BUFFERS ----------
+
+void rngNoiseReset(RNG_NOISE_BUFFER_T* buffer)
+{
+    buffer->first = 0;
+    buffer->stride = 1;
+    buffer->count = 0;
+    buffer->cursor = 0;
+}
+
+// next block of pairs for the steps first, first + stride, ...
+void rngNoiseFill(RNG_NOISE_BUFFER_T* buffer, RNG_STREAM_T* stream, unsigned int sensor, unsigned int first, unsigned int stride)
+{
+    if(stride == 0){stride = 1;}
+
+    rngNormal2Fill(stream, sensor, first, stride, RNG_NOISE_BLOCK, buffer->z);
+    buffer->first = first;
+    buffer->stride = stride;
+    buffer->count = RNG_NOISE_BLOCK;
+    buffer->cursor = 0;
+}
+
+// pair for step, normally the next one in the buffer. a step off the buffered
+// schedule (rate change, skipped sample) refills from step with the same stride
+float* rngNoiseNext(RNG_NOISE_BUFFER_T* buffer, RNG_STREAM_T* stream, unsigned int sensor, unsigned int step)
+{
+    if(rngNoiseEmpty(buffer) || buffer->first + buffer->cursor * buffer->stride != step)
+    {
+        rngNoiseFill(buffer, stream, sensor, step, buffer->stride);
+    }
+
+    return buffer->z + 2 * buffer->cursor++;
+}
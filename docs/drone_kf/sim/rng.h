@@ -0,0 +1,56 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// counter based random numbers, philox4x32-10 (Salmon et al. 2011).
+// a draw is a pure function of (seed, entity, sensor, step): there is no
+// generator state to advance, so every drone has its own reproducible stream
+// independent of how many other drones run, in which order the sensors are
+// sampled, or which thread steps them.
+//
+// key     = (seed, entity)
+// counter = (step, sensor, 0, 0)
+// one counter gives one box muller pair, both normals are returned.
+
+// pairs per noise buffer block
+#ifndef RNG_NOISE_BLOCK
+#define RNG_NOISE_BLOCK 64
+#endif
+
+typedef struct{
+    uint32_t key[2];
+} RNG_STREAM_T;
+
+// pairs of one sensor for the steps first, first + stride, ... precomputed in
+// one pass and handed out in order. the values are the same rngNormal2 gives
+// for those steps, buffering only changes when they are computed.
+typedef struct{
+    float z[2 * RNG_NOISE_BLOCK];
+    unsigned int first;  // step of the pair z[0], z[1]
+    unsigned int stride; // steps between pairs
+    int count;           // pairs filled
+    int cursor;          // next pair to hand out
+} RNG_NOISE_BUFFER_T;
+
+void rngStreamInit(RNG_STREAM_T* , uint32_t , uint32_t );
+void rngPhilox(const uint32_t* , const uint32_t* , uint32_t* );
+void rngNormal2(RNG_STREAM_T* , unsigned int , unsigned int , float* );
+void rngNormal2Fill(RNG_STREAM_T* , unsigned int , unsigned int , unsigned int , int , float* );
+
+void   rngNoiseReset(RNG_NOISE_BUFFER_T* );
+void   rngNoiseFill(RNG_NOISE_BUFFER_T* , RNG_STREAM_T* , unsigned int , unsigned int , unsigned int );
+float* rngNoiseNext(RNG_NOISE_BUFFER_T* , RNG_STREAM_T* , unsigned int , unsigned int );
+
+static inline int rngNoiseEmpty(RNG_NOISE_BUFFER_T* buffer)
+{
+    return buffer->cursor >= buffer->count;
+}
+
+// uniform in (0, 1) from the top 24 bits, never 0 so log is safe
+static inline float rngUniform(uint32_t bits)
+{
+    return ((float)(bits >> 8) + 0.5f) * (1.0f / 16777216.0f);
+}
+
+#endif
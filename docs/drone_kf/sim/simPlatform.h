@@ -0,0 +1,29 @@
+#ifndef SIM_PLATFORM_H
+#define SIM_PLATFORM_H
+
+// the only place that knows about emscripten. SIM_EXPORT keeps a function
+// alive and visible to the host in the wasm build and is empty natively.
+// simAlignedAlloc / simAlignedFree hide the platform aligned allocator.
+
+#include <stdlib.h>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/emscripten.h>
+#define SIM_EXPORT EMSCRIPTEN_KEEPALIVE
+#else
+#define SIM_EXPORT
+#endif
+
+#define SIM_CACHE_LINE 64
+
+#ifdef _MSC_VER
+#include <malloc.h>
+static inline void* simAlignedAlloc(size_t align, size_t size){ return _aligned_malloc(size, align); }
+static inline void  simAlignedFree(void* p){ _aligned_free(p); }
+#else
+// aligned_alloc wants a multiple of the alignment
+static inline void* simAlignedAlloc(size_t align, size_t size){ return aligned_alloc(align, (size + align - 1) / align * align); }
+static inline void  simAlignedFree(void* p){ free(p); }
+#endif
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef SIM_STATE_H
+#define SIM_STATE_H
+
+// fixed layout snapshot of one simulation, rewritten after every step. the
+// host keeps one Float32Array view on it (sim_state_ptr) and reads the fields
+// at the offsets below, no call per value and frame. all floats, same as
+// TELEMETRY_RECORD_T. bump SIM_STATE_VERSION whenever the layout changes.
+//
+// float offsets
+//   0 version    1 floats     2 step       3 time
+//   4 x          5 y          6 angle      7 vel x      8 vel y      9 angular vel
+//  10 x est     11 y est     12 angle est 13 vel x est 14 vel y est
+//  15 gnss x    16 gnss y    17 gnss vx   18 gnss vy
+//  19 P diag x  20 P diag y  21 P diag vx 22 P diag vy 23 P diag g
+//  24 left      25 right     26 target x  27 target y
+
+#define SIM_STATE_VERSION 1
+
+typedef struct{
+    float version;      // SIM_STATE_VERSION
+    float floats;       // SIM_STATE_FLOATS, size of the block
+    float step;         // sim steps since init, exact up to 2^24
+    float time;         // s
+    float truth[6];     // x, y, angle, vel x, vel y, angular vel
+    float estimate[5];  // x, y, angle, vel x, vel y
+    float gnss[4];      // latest arrived position and velocity
+    float Pdiag[5];     // filter covariance diagonal as of the last GNSS update
+    float effectors[2]; // left, right command of the last step
+    float target[2];    // target position of the last step
+} SIM_STATE_T;
+
+#define SIM_STATE_FLOATS (sizeof(SIM_STATE_T) / sizeof(float))
+
+#endif
@@ -0,0 +1,49 @@
+#include "telemetry.h"
+
+void telemetryInit(TELEMETRY_RING_T* ring)
+{
+    ring->head = 0;
+    ring->count = 0;
+    ring->seq = 0;
+    ring->dropped = 0;
+}
+
+// returns the slot for the next record, a full ring overwrites the oldest one
+TELEMETRY_RECORD_T* telemetryPush(TELEMETRY_RING_T* ring)
+{
+    TELEMETRY_RECORD_T* record = &(ring->records[ring->head]);
+
+    ring->head = (ring->head + 1) % TELEMETRY_CAPACITY;
+    if(ring->count < TELEMETRY_CAPACITY)
+    {
+        ring->count++;
+    }
+    else
+    {
+        ring->dropped++;
+    }
+
+    record->seq = (float)ring->seq;
+    ring->seq++;
+    return record;
+}
+
+// copies up to maxRecords pending records, oldest first, and returns how many
+int telemetryDrain(TELEMETRY_RING_T* ring, TELEMETRY_RECORD_T* out, int maxRecords)
+{
+    int n = (int)ring->count;
+    if(n > maxRecords)
+    {
+        n = maxRecords;
+    }
+
+    unsigned int tail = (ring->head + TELEMETRY_CAPACITY - ring->count) % TELEMETRY_CAPACITY;
+    for(int iter = 0; iter < n; iter++)
+    {
+        out[iter] = ring->records[tail];
+        tail = (tail + 1) % TELEMETRY_CAPACITY;
+    }
+
+    ring->count -= n;
+    return n;
+}
@@ -0,0 +1,40 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+// filter telemetry, one record per measurement update written into a
+// preallocated ring. nothing is allocated or formatted in the sim loop,
+// the host drains the ring in bulk (see telemetry_drain in box.c).
+// build with -DSIM_NO_TELEMETRY to compile the recording out completely.
+
+#ifdef SIM_NO_TELEMETRY
+#define TELEMETRY_ENABLED 0
+#else
+#define TELEMETRY_ENABLED 1
+#endif
+
+#define TELEMETRY_CAPACITY 256 // records kept before the oldest is overwritten
+
+// all floats so the host can read records through one Float32Array view
+typedef struct{
+    float seq;      // update counter, exact up to 2^24
+    float x[5];     // state after the update
+    float Pdiag[5]; // diagonal of the updated covariance
+    float y[4];     // innovation
+    float gainNorm; // frobenius norm of the kalman gain
+} TELEMETRY_RECORD_T;
+
+#define TELEMETRY_RECORD_FLOATS (sizeof(TELEMETRY_RECORD_T) / sizeof(float))
+
+typedef struct{
+    TELEMETRY_RECORD_T records[TELEMETRY_CAPACITY];
+    unsigned int head;    // next record to write
+    unsigned int count;   // records waiting to be drained
+    unsigned int seq;     // records written since init
+    unsigned int dropped; // records overwritten before they were drained
+} TELEMETRY_RING_T;
+
+void                telemetryInit(TELEMETRY_RING_T* );
+TELEMETRY_RECORD_T* telemetryPush(TELEMETRY_RING_T* );
+int                 telemetryDrain(TELEMETRY_RING_T* , TELEMETRY_RECORD_T* , int );
+
+#endif
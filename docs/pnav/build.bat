@@ -1,12 +1,12 @@
 @echo off
-rem Build script for WebAssembly
+rem Build script for WebAssembly, same settings as the makefile
 call "D:\Programs\Emscripten\emsdk\emsdk_env.bat" >nul 2>&1
 
 emcc sim\*.c ^
   -s WASM=1 ^
   -s MODULARIZE=1 -s EXPORT_ES6=1 -s ENVIRONMENT=web ^
-  -s EXPORTED_FUNCTIONS="["_sim_init","_sim_step","_drone_get_x","_drone_get_y","_drone_get_angle"]" ^
-  -s EXPORTED_RUNTIME_METHODS="["cwrap"]" ^
-  -o docs\sim.js
+  -s EXPORTED_FUNCTIONS="["_sim_init","_sim_step","_get_interceptor_pos_x","_get_interceptor_pos_y","_get_interceptor_kin_ang","_get_target_pos_x","_get_target_pos_y","_get_target_kin_ang","_sim_state_ptr"]" ^
+  -s EXPORTED_RUNTIME_METHODS="["cwrap","HEAPF32"]" ^
+  -o pnav_page\sim.js
 
-echo Build complete: docs\sim.jsb
\ No newline at end of file
+echo Build complete: pnav_page\sim.js
\ No newline at end of file
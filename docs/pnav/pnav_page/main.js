@@ -25,19 +25,26 @@ const Module = await createModule();
 // Bind C exports
 const sim_init = Module.cwrap('sim_init', 'number', ['number']);
 const sim_step = Module.cwrap('sim_step', null, ['number', 'number']);
-
-const get_interceptor_pos_x = Module.cwrap('get_interceptor_pos_x', 'number', []);
-const get_interceptor_pos_y = Module.cwrap('get_interceptor_pos_y', 'number', []);
-const get_interceptor_kin_ang = Module.cwrap('get_interceptor_kin_ang', 'number', []);
-
-const get_target_pos_x = Module.cwrap('get_target_pos_x', 'number', []);
-const get_target_pos_y = Module.cwrap('get_target_pos_y', 'number', []);
-const get_target_kin_ang = Module.cwrap('get_target_kin_ang', 'number', []);
+const sim_state_ptr = Module.cwrap('sim_state_ptr', 'number', []);
 
 // --- Sim/controls setup ---
 const DT = 0.01; // s
 if (sim_init(DT) !== 0) throw new Error('sim_init failed');
 
+// Shared state block (SIM_STATE_T in sim/sim.h), rewritten by the sim after every step.
+// The view is made once: the block never moves and the heap does not grow.
+const SIM_STATE_VERSION = 1;
+const S = {
+  STEP: 2, TIME: 3,
+  IC_X: 4, IC_Y: 5, IC_ANG: 6, IC_VEL: 7, IC_ROT_VEL: 8,
+  TG_X: 9, TG_Y: 10, TG_ANG: 11, TG_VEL: 12, TG_ROT_VEL: 13,
+  INPUT_LR: 14, INPUT_FB: 15, IC_TURN_ACC: 16
+};
+const SIM_STATE_PTR = sim_state_ptr();
+const simState = new Float32Array(Module.HEAPF32.buffer, SIM_STATE_PTR, Module.HEAPF32[(SIM_STATE_PTR >> 2) + 1]);
+if (simState[0] !== SIM_STATE_VERSION) throw new Error('sim state layout ' + simState[0] + ', page expects ' + SIM_STATE_VERSION);
+window.simState = simState; // inspect from the dev console
+
 let keys = { up:false, down:false, left:false, right:false };
 window.addEventListener('keydown', (e) => {
   if (e.key === 'ArrowUp')    { keys.up = true; e.preventDefault(); }
@@ -242,15 +249,15 @@ function tick(now) {
   }
 
   const interceptor = {
-    x:   get_interceptor_pos_x(),
-    y:   get_interceptor_pos_y(),
-    ang: get_interceptor_kin_ang()
+    x:   simState[S.IC_X],
+    y:   simState[S.IC_Y],
+    ang: simState[S.IC_ANG]
   };
 
   const target = {
-    x:   get_target_pos_x(),
-    y:   get_target_pos_y(),
-    ang: get_target_kin_ang()
+    x:   simState[S.TG_X],
+    y:   simState[S.TG_Y],
+    ang: simState[S.TG_ANG]
   };
 
   drawFrame(interceptor, target);
@@ -11,8 +11,10 @@ int counter = 0;
 int gps_flag = 0;
 
 SIM_T sim;
+SIM_STATE_T simState;
 AIRCRAFT_T ic;
 AIRCRAFT_T tg;
+float icTurnAcc = 0;
 
 uint8_t sim_init(float dt);
 void    sim_step(float thr, float steer);
@@ -21,6 +23,7 @@ float   drone_get_y(void);
 float   drone_get_angle(void);
 void targetStep(AIRCRAFT_T *target, VEC2D_T input);
 void interceptorStep(AIRCRAFT_T *target, AIRCRAFT_T *interceptor);
+void publishState(VEC2D_T input);
 
 
 uint8_t sim_init(float dt)
@@ -28,6 +31,7 @@ uint8_t sim_init(float dt)
     //srand(0);
 
     sim.dt = dt;
+    sim.step = 0;
     
     tg.airframe.maxThrustAcc = 0;
     tg.airframe.maxTurnAcc = 100; //mDs^2
@@ -43,6 +47,9 @@ uint8_t sim_init(float dt)
     ic.states.vel   = 300; // mDs
     ic.states.ang   = 120* 3.14 / 180; // mDs
 
+    VEC2D_T noInput = {0, 0};
+    publishState(noInput);
+
     return 0;
 }
 
@@ -58,12 +65,15 @@ input.x = leftRight; input.y = frontBack;
 
 targetStep(&tg, input);
 interceptorStep(&tg, &ic);
+sim.step++;
 
 if((fabsf(tg.states.pos.x - ic.states.pos.x) < 5) && (fabsf(tg.states.pos.y - ic.states.pos.y) < 5) )
 {
     sim_init(sim.dt);
 }
 
+publishState(input);
+
 
 }
 
@@ -111,6 +121,7 @@ void interceptorStep(AIRCRAFT_T *target, AIRCRAFT_T *interceptor)
 
     if (ic_turn_acc >  ic.airframe.maxTurnAcc){ic_turn_acc =  ic.airframe.maxTurnAcc;}
     if (ic_turn_acc < -ic.airframe.maxTurnAcc){ic_turn_acc = -ic.airframe.maxTurnAcc;}
+    icTurnAcc = ic_turn_acc;
 
 
     interceptor->states.ang += interceptor->states.rotVel * sim.dt;
@@ -126,6 +137,38 @@ void interceptorStep(AIRCRAFT_T *target, AIRCRAFT_T *interceptor)
 
 
 
+void publishState(VEC2D_T input)
+{
+    simState.version = SIM_STATE_VERSION;
+    simState.floats = SIM_STATE_FLOATS;
+    simState.step = sim.step;
+    simState.time = sim.step * sim.dt;
+
+    simState.interceptor[0] = ic.states.pos.x;
+    simState.interceptor[1] = ic.states.pos.y;
+    simState.interceptor[2] = ic.states.ang;
+    simState.interceptor[3] = ic.states.vel;
+    simState.interceptor[4] = ic.states.rotVel;
+
+    simState.target[0] = tg.states.pos.x;
+    simState.target[1] = tg.states.pos.y;
+    simState.target[2] = tg.states.ang;
+    simState.target[3] = tg.states.vel;
+    simState.target[4] = tg.states.rotVel;
+
+    simState.input[0] = input.x;
+    simState.input[1] = input.y;
+    simState.turnAcc = icTurnAcc;
+}
+
+
+// the block stays at this address for the lifetime of the module
+EMSCRIPTEN_KEEPALIVE
+SIM_STATE_T* sim_state_ptr()
+{
+    return &simState;
+}
+
 EMSCRIPTEN_KEEPALIVE
 float get_interceptor_pos_x()
 {
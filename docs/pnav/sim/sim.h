@@ -3,6 +3,30 @@
 
 typedef struct{
     float dt;
+    unsigned int step; // steps since the engagement started
 } SIM_T;
 
+// fixed layout snapshot, rewritten after every step. the page keeps one
+// Float32Array view on it (sim_state_ptr) and reads the fields at these
+// float offsets. bump SIM_STATE_VERSION whenever the layout changes.
+//   0 version    1 floats     2 step       3 time
+//   4 ic x       5 ic y       6 ic ang     7 ic vel     8 ic rot vel
+//   9 tg x      10 tg y      11 tg ang    12 tg vel    13 tg rot vel
+//  14 input left right       15 input front back
+//  16 ic turn acc command
+#define SIM_STATE_VERSION 1
+
+typedef struct{
+    float version;     // SIM_STATE_VERSION
+    float floats;      // SIM_STATE_FLOATS, size of the block
+    float step;
+    float time;        // s
+    float interceptor[5]; // x, y, ang, vel, rotVel
+    float target[5];      // x, y, ang, vel, rotVel
+    float input[2];       // leftRight, frontBack of the last step
+    float turnAcc;        // proportional navigation command, after the limit
+} SIM_STATE_T;
+
+#define SIM_STATE_FLOATS (sizeof(SIM_STATE_T) / sizeof(float))
+
 #endif
\ No newline at end of file